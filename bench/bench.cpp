@@ -0,0 +1,288 @@
+// headless runner for the benchmark scenes, results are written as JSON
+//
+// usage: jumphysics_bench [--scene name] [--steps n] [--threads n] [--ccd mode] [--rotation mode]
+//                         [--sweep n] [--output file]
+//
+// --ccd off, speculative or full puts every body of the scenes in that mode instead of their own,
+// --rotation exact or polynomial picks how the time of impact sweeps sample rotations.
+// --sweep n steps the scenes with at least SWEEP_MIN_BODIES bodies, or the one given by --scene,
+// on thread pools of 1, 2, 4 and so on up to n threads. it reports the speedup over one thread
+// and whether the final state is the one thread state bit for bit
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "profile.h"
+#include "scenes.h"
+#include "snapshot_delta.h"
+#include "thread_pool.h"
+#include "world.h"
+
+static const char* counter_names[PROF_COUNTER_COUNT] = {
+    "gjk_queries",         "sat_queries",          "ccd_queries",        "ccd_hits",
+    "discrete_fallbacks",  "ccd_translating",      "gjk_iteration_limit", "advancement_limit",
+    "bisection_limit",
+};
+
+static const char* histogram_names[PROF_HISTOGRAM_COUNT] = {
+    "gjk_iterations",
+    "ccd_advancements",
+    "ccd_bisections",
+};
+
+#define SWEEP_MIN_BODIES 200
+
+static const char* ccd_names[] = {"off", "speculative", "full"};
+static const char* rotation_names[] = {"exact", "polynomial"};
+
+static void buildScene(world* w, const scene* s, int ccd, rotation_sampling rotation) {
+  s->build(w);
+  w->params.toi_rotation = rotation;
+  if (ccd >= 0) {
+    for (size_t i = 0; i < w->bodies.size(); i++) {
+      w->bodies[i].ccd = (ccd_mode)ccd;
+    }
+  }
+}
+
+static void runScene(FILE* out, const scene* s, int steps, int ccd, rotation_sampling rotation,
+                     thread_pool* pool, bool first) {
+  world w;
+  w.pool = pool;
+  buildScene(&w, s, ccd, rotation);
+  if (steps <= 0) {
+    steps = s->steps;
+  }
+
+  // each step is also saved as a snapshot and delta encoded against the previous one, outside of
+  // the timed part
+  std::vector<uint8_t> previous(snapshot_size(&w));
+  save_snapshot(&w, previous.data(), previous.size());
+  std::vector<uint8_t> current;
+  std::vector<uint8_t> delta;
+  double snapshot_bytes = 0;
+  double delta_bytes = 0;
+  double encode_us = 0;
+
+  reset_profile();
+  step_timings total;
+  double seconds = 0;
+  for (int i = 0; i < steps; i++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    step_world(&w);
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    current.resize(snapshot_size(&w));
+    save_snapshot(&w, current.data(), current.size());
+    delta.resize(max_delta_size(current.data()));
+    start = std::chrono::steady_clock::now();
+    size_t size = encode_delta(previous.data(), current.data(), delta.data(), delta.size());
+    encode_us +=
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+            .count();
+    snapshot_bytes += current.size();
+    delta_bytes += size;
+    previous.swap(current);
+
+    total.broadphase += w.timings.broadphase;
+    total.narrowphase += w.timings.narrowphase;
+    total.solve += w.timings.solve;
+    total.toi += w.timings.toi;
+    total.integrate += w.timings.integrate;
+  }
+  profile_snapshot p;
+  get_profile_snapshot(&p, true);
+
+  fprintf(out, "%s    {\n", first ? "" : ",\n");
+  fprintf(out, "      \"name\": \"%s\",\n", s->name);
+  fprintf(out, "      \"bodies\": %d,\n", (int)w.bodies.size());
+  fprintf(out, "      \"steps\": %d,\n", steps);
+  fprintf(out, "      \"seconds\": %.6f,\n", seconds);
+  fprintf(out, "      \"steps_per_sec\": %.3f,\n", steps / seconds);
+  fprintf(out, "      \"stage_ms_per_step\": {\"broadphase\": %.4f, \"narrowphase\": %.4f, "
+               "\"solve\": %.4f, \"toi\": %.4f, \"integrate\": %.4f},\n",
+          total.broadphase / steps, total.narrowphase / steps, total.solve / steps,
+          total.toi / steps, total.integrate / steps);
+  fprintf(out, "      \"delta\": {\"snapshot_bytes\": %.1f, \"delta_bytes\": %.1f, "
+               "\"ratio\": %.2f, \"encode_us\": %.2f},\n",
+          snapshot_bytes / steps, delta_bytes / steps, snapshot_bytes / delta_bytes,
+          encode_us / steps);
+  fprintf(out, "      \"memory\": {\"max_pairs\": %d, \"max_contacts\": %d, "
+               "\"max_toi_pairs\": %d, \"max_terrain_pairs\": %d, \"max_sensor_pairs\": %d, "
+               "\"scratch_bytes\": %d},\n",
+          w.memory.max_pairs, w.memory.max_contacts, w.memory.max_toi_pairs,
+          w.memory.max_terrain_pairs, w.memory.max_sensor_pairs,
+          (int)w.memory.scratch_high_water);
+  fprintf(out, "      \"kernels\": {");
+  for (int i = 0; i < PROF_COUNTER_COUNT; i++) {
+    fprintf(out, "%s\"%s\": %llu", i ? ", " : "", counter_names[i],
+            (unsigned long long)p.counters[i]);
+  }
+  fprintf(out, "},\n");
+  fprintf(out, "      \"histograms\": {");
+  for (int h = 0; h < PROF_HISTOGRAM_COUNT; h++) {
+    fprintf(out, "%s\"%s\": {\"total\": %llu, \"log2_buckets\": [", h ? ", " : "",
+            histogram_names[h], (unsigned long long)p.totals[h]);
+    for (int b = 0; b < PROFILE_HISTOGRAM_BUCKETS; b++) {
+      fprintf(out, "%s%llu", b ? ", " : "", (unsigned long long)p.histograms[h][b]);
+    }
+    fprintf(out, "]}");
+  }
+  fprintf(out, "}\n    }");
+}
+
+static int sceneBodies(const scene* s) {
+  world w;
+  s->build(&w);
+  return (int)w.bodies.size();
+}
+
+// the same steps on every pool size, the final snapshots are compared with the one thread run
+static void sweepScene(FILE* out, const scene* s, int steps, int ccd, rotation_sampling rotation,
+                       int max_threads, bool first) {
+  if (steps <= 0) {
+    steps = s->steps;
+  }
+  std::vector<uint8_t> reference, state;
+  double base = 0;
+  fprintf(out, "%s    {\n      \"name\": \"%s\",\n      \"bodies\": %d,\n      \"steps\": %d,\n",
+          first ? "" : ",\n", s->name, sceneBodies(s), steps);
+  fprintf(out, "      \"runs\": [\n");
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    thread_pool pool(threads);
+    world w;
+    w.pool = threads > 1 ? &pool : nullptr;
+    buildScene(&w, s, ccd, rotation);
+    double seconds = 0;
+    double solve = 0;
+    for (int i = 0; i < steps; i++) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      step_world(&w);
+      seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      solve += w.timings.solve;
+    }
+    state.resize(snapshot_size(&w));
+    save_snapshot(&w, state.data(), state.size());
+    if (threads == 1) {
+      reference = state;
+      base = seconds;
+    }
+    fprintf(out, "%s        {\"threads\": %d, \"steps_per_sec\": %.3f, "
+                 "\"solve_ms_per_step\": %.4f, \"speedup\": %.2f, \"identical\": %s}",
+            threads > 1 ? ",\n" : "", threads, steps / seconds, solve / steps, base / seconds,
+            state == reference ? "true" : "false");
+  }
+  fprintf(out, "\n      ]\n    }");
+}
+
+int main(int argc, char** argv) {
+  const char* scene_name = nullptr;
+  const char* output = nullptr;
+  int steps = 0;
+  int threads = 1;
+  int sweep = 0;
+  int ccd = -1;  // the scene's own modes
+  int rotation = ROTATION_EXACT;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+      scene_name = argv[++i];
+    } else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+      steps = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) {
+      sweep = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--ccd") == 0 && i + 1 < argc) {
+      const char* mode = argv[++i];
+      for (int k = 0; k < 3; k++) {
+        if (strcmp(mode, ccd_names[k]) == 0) {
+          ccd = k;
+        }
+      }
+      if (ccd < 0) {
+        fprintf(stderr, "unknown ccd mode %s\n", mode);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--rotation") == 0 && i + 1 < argc) {
+      const char* mode = argv[++i];
+      rotation = -1;
+      for (int k = 0; k < 2; k++) {
+        if (strcmp(mode, rotation_names[k]) == 0) {
+          rotation = k;
+        }
+      }
+      if (rotation < 0) {
+        fprintf(stderr, "unknown rotation mode %s\n", mode);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--scene name] [--steps n] [--threads n] [--ccd mode] "
+              "[--rotation mode] [--sweep n] [--output file]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  const scene* selected = nullptr;
+  if (scene_name) {
+    selected = find_scene(scene_name);
+    if (!selected) {
+      fprintf(stderr, "unknown scene %s\n", scene_name);
+      return 1;
+    }
+  }
+
+  FILE* out = output ? fopen(output, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "could not open %s\n", output);
+    return 1;
+  }
+
+  if (sweep > 0) {
+    fprintf(out, "{\n  \"sweep\": %d,\n  \"ccd\": \"%s\",\n  \"rotation\": \"%s\",\n", sweep,
+            ccd < 0 ? "scene" : ccd_names[ccd], rotation_names[rotation]);
+    fprintf(out, "  \"scenes\": [\n");
+    bool first = true;
+    for (int i = 0; i < scene_count; i++) {
+      if (selected ? selected != scenes + i : sceneBodies(scenes + i) < SWEEP_MIN_BODIES) {
+        continue;
+      }
+      sweepScene(out, scenes + i, steps, ccd, (rotation_sampling)rotation, sweep, first);
+      first = false;
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) {
+      fclose(out);
+    }
+    return 0;
+  }
+
+  thread_pool pool(threads);
+#ifdef JUMPHYSICS_PROFILE
+  const char* profiled = "true";
+#else
+  const char* profiled = "false";
+#endif
+  fprintf(out, "{\n  \"threads\": %d,\n  \"profile\": %s,\n  \"ccd\": \"%s\",\n", threads, profiled,
+          ccd < 0 ? "scene" : ccd_names[ccd]);
+  fprintf(out, "  \"rotation\": \"%s\",\n  \"scenes\": [\n", rotation_names[rotation]);
+  bool first = true;
+  for (int i = 0; i < scene_count; i++) {
+    if (selected && selected != scenes + i) {
+      continue;
+    }
+    runScene(out, scenes + i, steps, ccd, (rotation_sampling)rotation,
+             threads > 1 ? &pool : nullptr, first);
+    first = false;
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
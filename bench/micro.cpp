@@ -0,0 +1,403 @@
+// per call cost of the numeric layer and the collision primitives
+//
+// usage: jumphysics_microbench [--filter substring] [--calls n] [--repeats n]
+//
+// every kernel runs a warmup pass and then a number of timed repeats of the same number of calls.
+// the minimum and median per call cost over the repeats are reported in nanoseconds and, on x86,
+// in reference cycles from the time stamp counter. the ccd group is followed by the accuracy of
+// polynomial rotation sampling against exact sampling at a few angular velocities
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "collision.h"
+#include "scenes.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#define INPUT_COUNT 64  // power of two, inputs are indexed with i & (INPUT_COUNT - 1)
+#define INPUT_MASK (INPUT_COUNT - 1)
+
+// runs calls iterations of one kernel and returns something derived from the results so the
+// calls can't be optimized away
+typedef uint32_t (*kernel_fn)(int calls);
+
+struct kernel {
+  const char* group;
+  const char* name;
+  kernel_fn run;
+};
+
+static volatile uint32_t sink;
+
+static float32 scalars[INPUT_COUNT];
+static float32 angles[INPUT_COUNT];
+static vec2 vectors[INPUT_COUNT];
+static simplex_vertex segments[INPUT_COUNT][2];
+static simplex_vertex triangles[INPUT_COUNT][3];
+// regular polygons with 3 to MAX_VERTICES sides, rotated and translated per input
+static vec2 polygons[MAX_VERTICES + 1][INPUT_COUNT][MAX_VERTICES];
+// small boxes at different angles swept towards a thin wall, half of them reach it
+static shape_registry sweep_shapes;
+static body bullets[INPUT_COUNT];
+static body wall;
+
+static uint32_t bits(float32 x) {
+  return x.v.v;
+}
+
+static float32 f(int32_t numerator, int32_t denominator = 1) {
+  return float32(numerator) / float32(denominator);
+}
+
+static void makeInputs() {
+  uint32_t state = 2024;
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    state = state * 1664525u + 1013904223u;
+    int32_t a = (int32_t)((state >> 8) & 1023) - 512;
+    state = state * 1664525u + 1013904223u;
+    int32_t b = (int32_t)((state >> 8) & 1023) - 512;
+    // never zero so division and normalize stay on their common path
+    scalars[i] = f(a | 1, 64);
+    angles[i] = f(a, 100);
+    vectors[i] = vec2(f(a | 1, 64), f(b | 1, 64));
+  }
+
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    vec2 a = vectors[i];
+    vec2 b = vectors[(i + 1) & INPUT_MASK];
+    vec2 c = vectors[(i + 2) & INPUT_MASK];
+    vec2 points[3] = {a, b, c};
+    for (int k = 0; k < 3; k++) {
+      simplex_vertex v;
+      v.point_a = points[k];
+      v.index_a = k;
+      v.point_b = vec2(float32(0), float32(0));
+      v.index_b = 0;
+      v.point = points[k];
+      v.b_coord = float32(0);
+      triangles[i][k] = v;
+      if (k < 2) {
+        segments[i][k] = v;
+      }
+    }
+  }
+
+  shape_registry shapes;
+  for (int sides = 3; sides <= MAX_VERTICES; sides++) {
+    body b = make_polygon(&shapes, vec2(float32(0), float32(0)), sides, float32(1), float32(1));
+    const shape* s = get_shape(&shapes, b.shape_id);
+    for (int i = 0; i < INPUT_COUNT; i++) {
+      b.r = angles[i];
+      // half of the inputs overlap the polygon at the origin
+      b.center = (i & 1) ? f(1, 2) * vectors[i] : f(4) * normalize(vectors[i]);
+      get_absolute_vertices(&b, s, polygons[sides][i]);
+    }
+  }
+
+  wall = make_box(&sweep_shapes, vec2(f(2), f(0)), f(1, 20), f(5), float32(0));
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    bullets[i] = make_box(&sweep_shapes, vec2(f(0), scalars[i]), f(1, 10), f(1, 10), float32(1));
+    bullets[i].r = angles[i];
+    bullets[i].vel = vec2((i & 1) ? f(3) : f(1), f(1, 2) * scalars[(i + 1) & INPUT_MASK]);
+  }
+}
+
+static uint32_t f32Add(int calls) {
+  float32 acc = float32(0);
+  for (int i = 0; i < calls; i++) {
+    acc = f32_add(acc, scalars[i & INPUT_MASK]);
+  }
+  return bits(acc);
+}
+
+static uint32_t f32Mul(int calls) {
+  uint32_t acc = 0;
+  for (int i = 0; i < calls; i++) {
+    acc ^= bits(f32_mul(scalars[i & INPUT_MASK], scalars[(i + 1) & INPUT_MASK]));
+  }
+  return acc;
+}
+
+static uint32_t f32Div(int calls) {
+  uint32_t acc = 0;
+  for (int i = 0; i < calls; i++) {
+    acc ^= bits(f32_div(scalars[i & INPUT_MASK], scalars[(i + 1) & INPUT_MASK]));
+  }
+  return acc;
+}
+
+static uint32_t f32Sqrt(int calls) {
+  uint32_t acc = 0;
+  for (int i = 0; i < calls; i++) {
+    acc ^= bits(f32_sqrt(abs(scalars[i & INPUT_MASK])));
+  }
+  return acc;
+}
+
+static uint32_t vecDot(int calls) {
+  uint32_t acc = 0;
+  for (int i = 0; i < calls; i++) {
+    acc ^= bits(dot(vectors[i & INPUT_MASK], vectors[(i + 1) & INPUT_MASK]));
+  }
+  return acc;
+}
+
+static uint32_t vecCross(int calls) {
+  uint32_t acc = 0;
+  for (int i = 0; i < calls; i++) {
+    acc ^= bits(cross(vectors[i & INPUT_MASK], vectors[(i + 1) & INPUT_MASK]));
+  }
+  return acc;
+}
+
+static uint32_t vecNormalize(int calls) {
+  uint32_t acc = 0;
+  for (int i = 0; i < calls; i++) {
+    acc ^= bits(normalize(vectors[i & INPUT_MASK]).x);
+  }
+  return acc;
+}
+
+static uint32_t matSet(int calls) {
+  uint32_t acc = 0;
+  mat22 m;
+  for (int i = 0; i < calls; i++) {
+    m.set(angles[i & INPUT_MASK]);
+    acc ^= bits(m.column1.y);
+  }
+  return acc;
+}
+
+template <int sides>
+static uint32_t supportPoint(int calls) {
+  uint32_t acc = 0;
+  for (int i = 0; i < calls; i++) {
+    acc += getSupportPoint(polygons[sides][i & INPUT_MASK], sides, vectors[(i + 1) & INPUT_MASK]);
+  }
+  return acc;
+}
+
+static uint32_t simplex2(int calls) {
+  uint32_t acc = 0;
+  vec2 origin(float32(0), float32(0));
+  for (int i = 0; i < calls; i++) {
+    simplex_vertex s[2] = {segments[i & INPUT_MASK][0], segments[i & INPUT_MASK][1]};
+    float32 divisor;
+    acc += solveSimplex2(s, &divisor, origin) ^ bits(divisor);
+  }
+  return acc;
+}
+
+static uint32_t simplex3(int calls) {
+  uint32_t acc = 0;
+  vec2 origin(float32(0), float32(0));
+  for (int i = 0; i < calls; i++) {
+    const simplex_vertex* in = triangles[i & INPUT_MASK];
+    simplex_vertex s[3] = {in[0], in[1], in[2]};
+    float32 divisor;
+    acc += solveSimplex3(s, &divisor, origin) ^ bits(divisor);
+  }
+  return acc;
+}
+
+static uint32_t segmentIntersect(int calls) {
+  uint32_t acc = 0;
+  for (int i = 0; i < calls; i++) {
+    vec2 intersection;
+    float32 ta, tb;
+    bool hit = line_segment_intersect(vectors[i & INPUT_MASK], vectors[(i + 1) & INPUT_MASK],
+                                      vectors[(i + 2) & INPUT_MASK], vectors[(i + 3) & INPUT_MASK],
+                                      &intersection, &ta, &tb);
+    acc += hit ? bits(ta) : 1;
+  }
+  return acc;
+}
+
+template <int sides>
+static uint32_t separatingAxis(int calls) {
+  uint32_t acc = 0;
+  for (int i = 0; i < calls; i++) {
+    vec2 mv;
+    float32 overlap;
+    bool hit = separating_axis_intersect(polygons[sides][i & INPUT_MASK], sides,
+                                         polygons[sides][(i + 1) & INPUT_MASK], sides, &mv,
+                                         &overlap);
+    acc += hit ? bits(overlap) : 1;
+  }
+  return acc;
+}
+
+// w is the angular velocity of the bullets in thousandths per step, zero takes the translation
+// only path
+template <int w, rotation_sampling rotation>
+static uint32_t sweep(int calls) {
+  uint32_t acc = 0;
+  const shape* wall_shape = get_shape(&sweep_shapes, wall.shape_id);
+  for (int i = 0; i < calls; i++) {
+    body b = bullets[i & INPUT_MASK];
+    b.w = f(w, 1000);
+    float32 t;
+    feature fa, fb;
+    vec2 impact;
+    bool hit = continuous_collision(&b, get_shape(&sweep_shapes, b.shape_id), &wall, wall_shape,
+                                    &t, &fa, &fb, &impact, float32(0), rotation);
+    acc += hit ? bits(t) : 1;
+  }
+  return acc;
+}
+
+// polynomial rotation sampling against exact sampling over the sweep inputs: the largest
+// differences in impact time and impact point between sweeps that both hit, and the number of
+// inputs only one of them reports a hit for
+static void rotationAccuracy() {
+  const int spins[] = {1, 100, 500, 750, 1000};
+  const int spin_count = sizeof(spins) / sizeof(spins[0]);
+  const shape* wall_shape = get_shape(&sweep_shapes, wall.shape_id);
+  printf("rotation sampling, polynomial against exact\n");
+  printf("  %-30s %9s %9s %9s\n", "angular velocity", "max dt", "max dp", "hit diff");
+  for (int k = 0; k < spin_count; k++) {
+    float32 max_time = float32(0);
+    float32 max_point = float32(0);
+    int hit_diff = 0;
+    for (int i = 0; i < INPUT_COUNT; i++) {
+      body b = bullets[i];
+      b.w = f(spins[k], 1000);
+      float32 t[2];
+      feature fa, fb;
+      vec2 impact[2];
+      bool hit[2];
+      for (int j = 0; j < 2; j++) {
+        hit[j] = continuous_collision(&b, get_shape(&sweep_shapes, b.shape_id), &wall,
+                                      wall_shape, t + j, &fa, &fb, impact + j, float32(0),
+                                      j ? ROTATION_POLYNOMIAL : ROTATION_EXACT);
+      }
+      if (hit[0] != hit[1]) {
+        hit_diff++;
+      } else if (hit[0]) {
+        max_time = max(max_time, abs(t[1] - t[0]));
+        max_point = max(max_point, magnitude(impact[1] - impact[0]));
+      }
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%.3f", spins[k] / 1000.0);
+    printf("  %-30s %9.2e %9.2e %9d\n", name, (double)(float)max_time, (double)(float)max_point,
+           hit_diff);
+  }
+}
+
+static const kernel kernels[] = {
+    {"float32", "f32_add", f32Add},
+    {"float32", "f32_mul", f32Mul},
+    {"float32", "f32_div", f32Div},
+    {"float32", "f32_sqrt", f32Sqrt},
+    {"vector", "dot", vecDot},
+    {"vector", "cross", vecCross},
+    {"vector", "normalize", vecNormalize},
+    {"vector", "mat22::set", matSet},
+    {"support", "getSupportPoint/3", supportPoint<3>},
+    {"support", "getSupportPoint/4", supportPoint<4>},
+    {"support", "getSupportPoint/6", supportPoint<6>},
+    {"support", "getSupportPoint/8", supportPoint<8>},
+    {"gjk", "solveSimplex2", simplex2},
+    {"gjk", "solveSimplex3", simplex3},
+    {"segment", "line_segment_intersect", segmentIntersect},
+    {"sat", "separating_axis_intersect/3", separatingAxis<3>},
+    {"sat", "separating_axis_intersect/4", separatingAxis<4>},
+    {"sat", "separating_axis_intersect/6", separatingAxis<6>},
+    {"sat", "separating_axis_intersect/8", separatingAxis<8>},
+    {"ccd", "continuous_collision/translate", sweep<0, ROTATION_EXACT>},
+    {"ccd", "continuous_collision/rotate", sweep<1, ROTATION_EXACT>},
+    {"ccd", "continuous_collision/rotate_poly", sweep<1, ROTATION_POLYNOMIAL>},
+    {"ccd", "continuous_collision/spin", sweep<500, ROTATION_EXACT>},
+    {"ccd", "continuous_collision/spin_poly", sweep<500, ROTATION_POLYNOMIAL>},
+};
+static const int kernel_count = sizeof(kernels) / sizeof(kernels[0]);
+
+static uint64_t readCycles() {
+#ifdef HAVE_RDTSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct sample {
+  double ns;
+  double cycles;
+};
+
+static bool byTime(const sample& a, const sample& b) {
+  return a.ns < b.ns;
+}
+
+static void measure(const kernel* k, int calls, int repeats) {
+  sink = k->run(calls);  // warmup
+
+  std::vector<sample> samples(repeats);
+  for (int r = 0; r < repeats; r++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t c0 = readCycles();
+    sink = k->run(calls);
+    uint64_t c1 = readCycles();
+    double ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    samples[r].ns = ns / calls;
+    samples[r].cycles = (double)(c1 - c0) / calls;
+  }
+  std::sort(samples.begin(), samples.end(), byTime);
+  const sample& best = samples[0];
+  const sample& median = samples[repeats / 2];
+#ifdef HAVE_RDTSC
+  printf("  %-30s %9.2f %9.2f %9.1f %9.1f\n", k->name, best.ns, median.ns, best.cycles,
+         median.cycles);
+#else
+  printf("  %-30s %9.2f %9.2f %9s %9s\n", k->name, best.ns, median.ns, "-", "-");
+#endif
+}
+
+int main(int argc, char** argv) {
+  const char* filter = nullptr;
+  int calls = 100000;
+  int repeats = 15;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--calls") == 0 && i + 1 < argc) {
+      calls = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+      repeats = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--filter substring] [--calls n] [--repeats n]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (calls < 1 || repeats < 1) {
+    fprintf(stderr, "calls and repeats must be positive\n");
+    return 1;
+  }
+
+  makeInputs();
+  printf("%d calls x %d repeats, per call\n", calls, repeats);
+  printf("  %-30s %9s %9s %9s %9s\n", "kernel", "min ns", "med ns", "min cyc", "med cyc");
+  const char* group = nullptr;
+  for (int i = 0; i < kernel_count; i++) {
+    const kernel* k = kernels + i;
+    if (filter && !strstr(k->name, filter) && !strstr(k->group, filter)) {
+      continue;
+    }
+    if (!group || strcmp(group, k->group) != 0) {
+      group = k->group;
+      printf("%s\n", group);
+    }
+    measure(k, calls, repeats);
+  }
+  if (!filter || strstr("ccd", filter)) {
+    rotationAccuracy();
+  }
+  return 0;
+}
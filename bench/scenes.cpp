@@ -0,0 +1,435 @@
+#include "scenes.h"
+#include <string.h>
+#include "math_util.h"
+#include "terrain.h"
+
+// 60 Hz with 10 m/s^2 of gravity, world velocities are per step
+static const float32 step_gravity = float32(-10) / float32(3600);
+
+// deterministic generator so scenes don't depend on the standard library
+struct lcg {
+  uint32_t state;
+  uint32_t next() {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+  }
+  // uniform in [low, high] with 1/1024 resolution
+  float32 range(float32 low, float32 high) {
+    float32 u = float32((int32_t)(next() & 1023)) / float32(1023);
+    return low + u * (high - low);
+  }
+};
+
+static float32 f(int32_t numerator, int32_t denominator = 1) {
+  return float32(numerator) / float32(denominator);
+}
+
+static body makeBody(shape_registry* shapes, vec2 center, int shape_id, float32 density) {
+  body b;
+  b.center = center;
+  b.shape_id = shape_id;
+  b.friction = f(6, 10);
+  set_body_mass(&b, get_shape(shapes, b.shape_id), density);
+  return b;
+}
+
+body make_box(shape_registry* shapes, vec2 center, float32 half_width, float32 half_height,
+              float32 density) {
+  return makeBody(shapes, center, add_box(shapes, half_width, half_height), density);
+}
+
+body make_polygon(shape_registry* shapes, vec2 center, int sides, float32 radius,
+                  float32 density) {
+  vec2 vertices[MAX_VERTICES];
+  for (int i = 0; i < sides; i++) {
+    float32 angle = F32_M_2PI * f(i, sides);
+    vertices[i] = vec2(radius * f32_cos(angle), radius * f32_sin(angle));
+  }
+  return makeBody(shapes, center, add_shape(shapes, vertices, sides), density);
+}
+
+body make_circle(shape_registry* shapes, vec2 center, float32 radius, float32 density) {
+  return makeBody(shapes, center, add_circle(shapes, vec2(f(0), f(0)), radius), density);
+}
+
+body make_capsule(shape_registry* shapes, vec2 center, float32 half_length, float32 radius,
+                  float32 density) {
+  int id = add_capsule(shapes, vec2(-half_length, f(0)), vec2(half_length, f(0)), radius);
+  return makeBody(shapes, center, id, density);
+}
+
+static void ground(world* w, float32 half_width) {
+  add_body(w, make_box(&w->shapes, vec2(float32(0), float32(-1)), half_width, float32(1),
+                       float32(0)));
+}
+
+static void buildPyramid(world* w) {
+  w->params.gravity = vec2(float32(0), step_gravity);
+  ground(w, f(40));
+  const int rows = 20;
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < rows - r; c++) {
+      vec2 center(f(-rows * 55 + r * 55 + c * 110, 100), f(5 + r * 10, 10));
+      add_body(w, make_box(&w->shapes, center, f(1, 2), f(1, 2), float32(1)));
+    }
+  }
+}
+
+static void buildPolygonPile(world* w) {
+  w->params.gravity = vec2(float32(0), step_gravity);
+  ground(w, f(12));
+  add_body(w, make_box(&w->shapes, vec2(f(-12), f(10)), f(1, 2), f(10), float32(0)));
+  add_body(w, make_box(&w->shapes, vec2(f(12), f(10)), f(1, 2), f(10), float32(0)));
+  lcg random = {12345};
+  for (int i = 0; i < 150; i++) {
+    int sides = 3 + (int)(random.next() % (MAX_VERTICES - 2));
+    vec2 center(f(-10 + (i % 10) * 2) + random.range(f(-2, 10), f(2, 10)), f(1 + (i / 10) * 2));
+    float32 radius = random.range(f(4, 10), f(8, 10));
+    add_body(w, make_polygon(&w->shapes, center, sides, radius, float32(1)));
+  }
+}
+
+// the polygon pile on speculative contacts with a few small full time of impact bullets dropped
+// into it
+static void buildSpeculativePile(world* w) {
+  buildPolygonPile(w);
+  for (size_t i = 0; i < w->bodies.size(); i++) {
+    w->bodies[i].ccd = CCD_SPECULATIVE;
+  }
+  for (int i = 0; i < 4; i++) {
+    body b = make_box(&w->shapes, vec2(f(-3 + i * 2), f(80)), f(1, 5), f(1, 5), float32(1));
+    b.vel = vec2(f(0), f(-2));
+    b.ccd = CCD_FULL;
+    add_body(w, b);
+  }
+}
+
+// thin walls with small boxes crossing several wall thicknesses per step
+static void buildBullets(world* w) {
+  for (int i = 0; i < 3; i++) {
+    add_body(w, make_box(&w->shapes, vec2(f(10 + i * 10), f(0)), f(5, 100), f(15), float32(0)));
+  }
+  for (int i = 0; i < 20; i++) {
+    body b = make_box(&w->shapes, vec2(f(0), f(-140 + i * 14, 10)), f(1, 10), f(1, 10), float32(1));
+    b.vel = vec2(f(3, 2), f(0));
+    add_body(w, b);
+  }
+}
+
+// bullets with their rotation locked, as characters and platforms usually are, fired both ways
+// between two thin walls
+static void buildLockedBullets(world* w) {
+  for (int i = 0; i < 2; i++) {
+    add_body(w, make_box(&w->shapes, vec2(f(-10 + i * 20), f(0)), f(5, 100), f(15), float32(0)));
+  }
+  for (int i = 0; i < 20; i++) {
+    body b = make_box(&w->shapes, vec2(f(0), f(-140 + i * 14, 10)), f(1, 10), f(1, 10), float32(1));
+    b.vel = vec2(f(i % 2 ? 3 : -3, 2), f(i % 4 - 2, 100));
+    b.inv_I = float32(0);
+    add_body(w, b);
+  }
+}
+
+// kinematic blades stirring a box of debris
+static void buildFans(world* w) {
+  w->params.gravity = vec2(float32(0), step_gravity);
+  ground(w, f(12));
+  add_body(w, make_box(&w->shapes, vec2(f(-12), f(10)), f(1, 2), f(10), float32(0)));
+  add_body(w, make_box(&w->shapes, vec2(f(12), f(10)), f(1, 2), f(10), float32(0)));
+  for (int i = 0; i < 2; i++) {
+    body blade = make_box(&w->shapes, vec2(f(-5 + i * 10), f(4)), f(4), f(1, 5), float32(0));
+    blade.w = f(i == 0 ? 1 : -1, 20);
+    add_body(w, blade);
+  }
+  for (int i = 0; i < 60; i++) {
+    vec2 center(f(-9 + (i % 10) * 2), f(9 + (i / 10) * 2));
+    add_body(w, make_box(&w->shapes, center, f(2, 5), f(2, 5), float32(1)));
+  }
+}
+
+// separate stacks that settle and stay at rest
+static void buildRestingGrid(world* w) {
+  w->params.gravity = vec2(float32(0), step_gravity);
+  ground(w, f(40));
+  for (int c = 0; c < 10; c++) {
+    for (int r = 0; r < 10; r++) {
+      vec2 center(f(-20 + c * 4), f(5 + r * 10, 10));
+      add_body(w, make_box(&w->shapes, center, f(1, 2), f(1, 2), float32(1)));
+    }
+  }
+}
+
+// circles, capsules and rounded boxes poured into a box, with a few fast balls thrown in
+static void buildRounded(world* w) {
+  w->params.gravity = vec2(float32(0), step_gravity);
+  ground(w, f(12));
+  add_body(w, make_box(&w->shapes, vec2(f(-12), f(10)), f(1, 2), f(10), float32(0)));
+  add_body(w, make_box(&w->shapes, vec2(f(12), f(10)), f(1, 2), f(10), float32(0)));
+  vec2 box[4] = {vec2(f(-3, 10), f(-3, 10)), vec2(f(3, 10), f(-3, 10)), vec2(f(3, 10), f(3, 10)),
+                 vec2(f(-3, 10), f(3, 10))};
+  int rounded_box = add_rounded_shape(&w->shapes, box, 4, f(1, 10));
+  for (int i = 0; i < 150; i++) {
+    vec2 center(f(-9 + (i % 10) * 2), f(1 + (i / 10) * 2));
+    body b;
+    if (i % 3 == 0) {
+      b = make_circle(&w->shapes, center, f(4, 10), float32(1));
+    } else if (i % 3 == 1) {
+      b = make_capsule(&w->shapes, center, f(4, 10), f(3, 10), float32(1));
+      b.r = f(i, 7);
+    } else {
+      b = makeBody(&w->shapes, center, rounded_box, float32(1));
+    }
+    add_body(w, b);
+  }
+  for (int i = 0; i < 4; i++) {
+    body ball = make_circle(&w->shapes, vec2(f(-10 + i * 6), f(36)), f(1, 4), float32(1));
+    ball.vel = vec2(f(0), f(-1));
+    add_body(w, ball);
+  }
+}
+
+// mixed bodies dropped on a long sawtooth chain with walls at both ends and a solid loop in the
+// middle. half the bodies come before the terrain body and half after it
+static void buildTerrain(world* w) {
+  w->params.gravity = vec2(float32(0), step_gravity);
+  lcg random = {777};
+  const int count = 2000;
+  std::vector<vec2> points(count + 2);
+  points[0] = vec2(f(-100), f(20));
+  for (int i = 0; i < count; i++) {
+    int t = i % 80;
+    float32 height = f(t < 40 ? 40 - t : t - 40, 40) + random.range(f(-2, 100), f(2, 100));
+    points[i + 1] = vec2(f(-1000 + i, 10), height);
+  }
+  points[count + 1] = vec2(f(1000 - 1, 10), f(20));
+  add_chain(&w->terrain, points.data(), count + 2, false);
+  vec2 rock[6];
+  for (int i = 0; i < 6; i++) {
+    float32 angle = -F32_M_2PI * f(i, 6);
+    rock[i] = vec2(f(2) * f32_cos(angle), f(4) + f(2) * f32_sin(angle));
+  }
+  add_chain(&w->terrain, rock, 6, true);
+
+  for (int i = 0; i < 200; i++) {
+    if (i == 100) {
+      finish_terrain(w, f(6, 10));
+    }
+    vec2 center(f(-40 + (i % 20) * 4) + random.range(f(-1), f(1)), f(8 + (i / 20) * 2));
+    body b;
+    if (i % 4 == 0) {
+      b = make_box(&w->shapes, center, f(2, 5), f(3, 10), float32(1));
+    } else if (i % 4 == 1) {
+      b = make_polygon(&w->shapes, center, 3 + i % 5, f(1, 2), float32(1));
+    } else if (i % 4 == 2) {
+      b = make_circle(&w->shapes, center, f(2, 5), float32(1));
+    } else {
+      b = make_capsule(&w->shapes, center, f(3, 10), f(1, 5), float32(1));
+    }
+    b.r = f(i, 11);
+    add_body(w, b);
+  }
+}
+
+// mixed bodies dropped on rolling heightfield ground with cliffs at both ends and craters dug
+// into it after it was laid out
+static void buildHeightfield(world* w) {
+  w->params.gravity = vec2(float32(0), step_gravity);
+  heightfield* h = &w->field;
+  const int count = 1000;
+  h->origin = vec2(f(-100), f(0));
+  h->spacing = f(1, 5);
+  h->heights.resize(count);
+  lcg random = {4242};
+  for (int i = 0; i < count; i++) {
+    int t = i % 150;
+    h->heights[i] = f(t < 75 ? t : 150 - t, 30) + random.range(f(-1, 100), f(1, 100));
+  }
+  h->heights[0] = f(20);
+  h->heights[count - 1] = f(20);
+  for (int crater = 0; crater < 8; crater++) {
+    int center = 100 + crater * 110;
+    for (int i = center - 10; i <= center + 10; i++) {
+      int d = i - center;
+      h->heights[i] -= f(100 - d * d, 100);
+    }
+  }
+  finish_terrain(w, f(6, 10));
+
+  for (int i = 0; i < 200; i++) {
+    vec2 center(f(-40 + (i % 20) * 4) + random.range(f(-1), f(1)), f(8 + (i / 20) * 2));
+    body b;
+    if (i % 4 == 0) {
+      b = make_box(&w->shapes, center, f(2, 5), f(3, 10), float32(1));
+    } else if (i % 4 == 1) {
+      b = make_polygon(&w->shapes, center, 3 + i % 5, f(1, 2), float32(1));
+    } else if (i % 4 == 2) {
+      b = make_circle(&w->shapes, center, f(2, 5), float32(1));
+    } else {
+      b = make_capsule(&w->shapes, center, f(3, 10), f(1, 5), float32(1));
+    }
+    b.r = f(i, 11);
+    add_body(w, b);
+  }
+}
+
+// children moved by offsets from origin, the body is centered on their centroid
+static body makeCompound(shape_registry* shapes, vec2 origin, const int* children,
+                         const vec2* offsets, int count, float32 density) {
+  int id = -1;
+  vec2 centroid;
+  make_compound(shapes, children, offsets, count, &id, &centroid);
+  return makeBody(shapes, origin + centroid, id, density);
+}
+
+// L shapes, I beams and carts on wheels tumbling down a valley of chain slopes onto each other and
+// onto plain boxes, with a few thrown fast enough to need time of impact
+static void buildCompounds(world* w) {
+  w->params.gravity = vec2(float32(0), step_gravity);
+  vec2 valley[6] = {vec2(f(-30), f(30)), vec2(f(-30), f(12)), vec2(f(-6), f(0)),
+                    vec2(f(6), f(0)),     vec2(f(30), f(12)),  vec2(f(30), f(30))};
+  add_chain(&w->terrain, valley, 6, false);
+  finish_terrain(w, f(6, 10));
+
+  shape_registry* shapes = &w->shapes;
+  int bar = add_box(shapes, f(1), f(1, 4));
+  int post = add_box(shapes, f(1, 4), f(3, 4));
+  int deck = add_box(shapes, f(6, 5), f(1, 5));
+  int wheel = add_circle(shapes, vec2(f(0), f(0)), f(3, 10));
+  const int l_children[2] = {bar, post};
+  const vec2 l_offsets[2] = {vec2(f(0), f(0)), vec2(f(-3, 4), f(1))};
+  const int i_children[3] = {bar, post, bar};
+  const vec2 i_offsets[3] = {vec2(f(0), f(1)), vec2(f(0), f(0)), vec2(f(0), f(-1))};
+  const int cart_children[3] = {deck, wheel, wheel};
+  const vec2 cart_offsets[3] = {vec2(f(0), f(0)), vec2(f(-4, 5), f(-3, 10)),
+                                vec2(f(4, 5), f(-3, 10))};
+  lcg random = {99};
+  for (int i = 0; i < 160; i++) {
+    vec2 origin(f(-24 + (i % 12) * 4) + random.range(f(-1, 2), f(1, 2)), f(16 + (i / 12) * 4));
+    body b;
+    if (i % 4 == 0) {
+      b = makeCompound(shapes, origin, l_children, l_offsets, 2, float32(1));
+    } else if (i % 4 == 1) {
+      b = makeCompound(shapes, origin, i_children, i_offsets, 3, float32(1));
+    } else if (i % 4 == 2) {
+      b = makeCompound(shapes, origin, cart_children, cart_offsets, 3, float32(1));
+    } else {
+      b = make_box(shapes, origin, f(1, 2), f(1, 2), float32(1));
+    }
+    b.r = f(i, 13);
+    add_body(w, b);
+  }
+  for (int i = 0; i < 4; i++) {
+    body b = makeCompound(shapes, vec2(f(-20 + i * 12), f(76)), l_children, l_offsets, 2,
+                          float32(1));
+    b.vel = vec2(f(0), f(-1));
+    b.w = f(1, 10);
+    add_body(w, b);
+  }
+}
+
+// four turrets in a walled arena each firing a ring of small fast bullets into loose debris. a
+// turret's bullets share its negative group so they start inside it without touching it, bullets
+// ignore bullets and debris ignores debris, so almost every overlapping pair is filtered out
+static void buildBulletHell(world* w) {
+  const uint32_t bullet = 2;
+  const uint32_t debris = 4;
+  for (int i = 0; i < 4; i++) {
+    float32 side = f(i % 2 ? 20 : -20);
+    vec2 center = i < 2 ? vec2(side, f(0)) : vec2(f(0), side);
+    float32 half_width = i < 2 ? f(1, 2) : f(41, 2);
+    float32 half_height = i < 2 ? f(41, 2) : f(1, 2);
+    add_body(w, make_box(&w->shapes, center, half_width, half_height, float32(0)));
+  }
+  lcg random = {2024};
+  for (int i = 0; i < 80; i++) {
+    vec2 center(random.range(f(-18), f(18)), random.range(f(-18), f(18)));
+    body b = make_box(&w->shapes, center, f(3, 10), f(3, 10), float32(1));
+    b.filter.category = debris;
+    b.filter.mask = ~debris;
+    add_body(w, b);
+  }
+  int round = add_circle(&w->shapes, vec2(f(0), f(0)), f(1, 10));
+  for (int t = 0; t < 4; t++) {
+    vec2 center(f(t % 2 ? 8 : -8), f(t < 2 ? 8 : -8));
+    body turret = make_box(&w->shapes, center, f(1), f(1), float32(0));
+    turret.filter.group = -1 - t;
+    add_body(w, turret);
+    for (int i = 0; i < 100; i++) {
+      float32 angle = F32_M_2PI * f(i, 100);
+      float32 speed = random.range(f(3, 10), f(6, 10));
+      body b = makeBody(&w->shapes, center, round, float32(1));
+      b.vel = vec2(speed * f32_cos(angle), speed * f32_sin(angle));
+      b.filter.category = bullet;
+      b.filter.mask = ~bullet;
+      b.filter.group = -1 - t;
+      add_body(w, b);
+    }
+  }
+}
+
+// boxes and balls falling through pickup zones of every kind onto the ground, where a kinematic
+// sensor sweeps through the pile. nothing collides with the sensors, they only report overlaps
+static void buildSensors(world* w) {
+  w->params.gravity = vec2(float32(0), step_gravity);
+  ground(w, f(15));
+  add_body(w, make_box(&w->shapes, vec2(f(-15), f(10)), f(1, 2), f(10), float32(0)));
+  add_body(w, make_box(&w->shapes, vec2(f(15), f(10)), f(1, 2), f(10), float32(0)));
+
+  shape_registry* shapes = &w->shapes;
+  int bar = add_box(shapes, f(1), f(1, 4));
+  int post = add_box(shapes, f(1, 4), f(3, 4));
+  const int l_children[2] = {bar, post};
+  const vec2 l_offsets[2] = {vec2(f(0), f(0)), vec2(f(-3, 4), f(1))};
+  for (int i = 0; i < 5; i++) {
+    vec2 center(f(-10 + i * 5), f(7));
+    body zone;
+    if (i % 3 == 0) {
+      zone = make_circle(shapes, center, f(3, 2), float32(0));
+    } else if (i % 3 == 1) {
+      zone = make_box(shapes, center, f(2), f(1), float32(0));
+      zone.r = f(1, 2);
+    } else {
+      zone = makeCompound(shapes, center, l_children, l_offsets, 2, float32(0));
+    }
+    zone.sensor = true;
+    add_body(w, zone);
+  }
+  body sweeper = make_box(shapes, vec2(f(-14), f(2)), f(1, 2), f(2), float32(0));
+  sweeper.vel = vec2(f(1, 10), f(0));
+  sweeper.sensor = true;
+  add_body(w, sweeper);
+
+  lcg random = {31};
+  for (int i = 0; i < 100; i++) {
+    vec2 center(f(-23 + (i % 10) * 5, 2) + random.range(f(-1, 4), f(1, 4)), f(12 + (i / 10) * 2));
+    body b = i % 2 ? make_circle(shapes, center, f(2, 5), float32(1))
+                   : make_box(shapes, center, f(2, 5), f(2, 5), float32(1));
+    add_body(w, b);
+  }
+}
+
+const scene scenes[] = {
+    {"pyramid", buildPyramid, 300},
+    {"polygon_pile", buildPolygonPile, 300},
+    {"speculative_pile", buildSpeculativePile, 300},
+    {"bullets", buildBullets, 60},
+    {"locked_bullets", buildLockedBullets, 60},
+    {"fans", buildFans, 300},
+    {"resting_grid", buildRestingGrid, 300},
+    {"rounded", buildRounded, 300},
+    {"terrain", buildTerrain, 300},
+    {"heightfield", buildHeightfield, 300},
+    {"compounds", buildCompounds, 300},
+    {"bullet_hell", buildBulletHell, 120},
+    {"sensors", buildSensors, 300},
+};
+const int scene_count = sizeof(scenes) / sizeof(scenes[0]);
+
+const scene* find_scene(const char* name) {
+  for (int i = 0; i < scene_count; i++) {
+    if (strcmp(scenes[i].name, name) == 0) {
+      return scenes + i;
+    }
+  }
+  return nullptr;
+}
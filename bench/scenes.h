@@ -0,0 +1,33 @@
+#ifndef SCENES_H
+#define SCENES_H
+#include "world.h"
+
+// reproducible benchmark scenes. positions and sizes come from integer arithmetic converted to
+// float32 so a scene is bit-identical on every platform
+
+typedef void (*scene_fn)(world* w);
+
+struct scene {
+  const char* name;
+  scene_fn build;
+  int steps;  // default number of steps to run
+};
+
+extern const scene scenes[];
+extern const int scene_count;
+
+// null if there is no scene with that name
+const scene* find_scene(const char* name);
+
+// convex polygons centered on their centroid, density 0 gives a static body. the shape is added
+// to shapes
+body make_box(shape_registry* shapes, vec2 center, float32 half_width, float32 half_height,
+              float32 density);
+body make_polygon(shape_registry* shapes, vec2 center, int sides, float32 radius,
+                  float32 density);
+body make_circle(shape_registry* shapes, vec2 center, float32 radius, float32 density);
+// capsule along x
+body make_capsule(shape_registry* shapes, vec2 center, float32 half_length, float32 radius,
+                  float32 density);
+
+#endif  // SCENES_H
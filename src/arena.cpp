@@ -0,0 +1,76 @@
+#include "arena.h"
+#include <stdlib.h>
+
+struct arenaBlock {
+  arenaBlock* next;
+};
+
+static void freeOverflow(arena* a) {
+  while (a->overflow) {
+    arenaBlock* next = a->overflow->next;
+    free(a->overflow);
+    a->overflow = next;
+  }
+  a->overflow_bytes = 0;
+}
+
+arena& arena::operator=(const arena& other) {
+  if (this != &other) {
+    freeOverflow(this);
+    free(base);
+    base = nullptr;
+    capacity = other.capacity;
+    used = 0;
+    high_water = 0;
+    grows = 0;
+  }
+  return *this;
+}
+
+arena::~arena() {
+  freeOverflow(this);
+  free(base);
+}
+
+void* arena_alloc(arena* a, size_t size, size_t align) {
+  if (size == 0) {
+    return a->base + a->used;
+  }
+  if (!a->base && a->capacity) {
+    a->base = (uint8_t*)malloc(a->capacity);
+    a->grows++;
+  }
+  size_t offset = (a->used + align - 1) & ~(align - 1);
+  if (a->base && offset + size <= a->capacity) {
+    a->used = offset + size;
+    if (a->used + a->overflow_bytes > a->high_water) {
+      a->high_water = a->used + a->overflow_bytes;
+    }
+    return a->base + offset;
+  }
+
+  // header padded so the block data keeps the alignment malloc gives
+  size_t header = (sizeof(arenaBlock) + align - 1) & ~(align - 1);
+  if (header < alignof(max_align_t)) {
+    header = alignof(max_align_t);
+  }
+  arenaBlock* block = (arenaBlock*)malloc(header + size);
+  block->next = a->overflow;
+  a->overflow = block;
+  a->overflow_bytes += size + align;
+  if (a->used + a->overflow_bytes > a->high_water) {
+    a->high_water = a->used + a->overflow_bytes;
+  }
+  return (uint8_t*)block + header;
+}
+
+void reset_arena(arena* a) {
+  if (a->overflow) {
+    freeOverflow(a);
+    // room for everything the last step needed so it fits in one block next time
+    free(a->base);
+    a->capacity = a->high_water + a->high_water / 4;
+    a->base = nullptr;
+  }
+  a->used = 0;
+}
@@ -0,0 +1,47 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+// linear allocator for scratch data that only lives for one step. allocation bumps an offset in
+// one block and reset frees everything at once. requests past the capacity get their own heap
+// blocks for the rest of the step, the next reset then grows the main block to the high water
+// mark, so a steady workload settles on one block and stops allocating
+
+struct arenaBlock;
+
+struct arena {
+  arena() {}
+  explicit arena(size_t capacity) : capacity(capacity) {}
+  // copies get the same capacity but their own memory, allocated on first use
+  arena(const arena& other) : capacity(other.capacity) {}
+  arena& operator=(const arena& other);
+  ~arena();
+
+  uint8_t* base = nullptr;
+  size_t capacity = 0;
+  size_t used = 0;
+  size_t high_water = 0;          // most bytes used by a single step, including overflow
+  size_t overflow_bytes = 0;      // bytes in overflow blocks since the last reset
+  arenaBlock* overflow = nullptr;
+  int grows = 0;                  // times the main block was (re)allocated
+};
+
+// aligned to align, which must be a power of two
+void* arena_alloc(arena* a, size_t size, size_t align);
+
+// free everything allocated since the last reset
+void reset_arena(arena* a);
+
+// count default constructed elements, they are never destroyed so T must not own resources
+template <typename T>
+T* arena_array(arena* a, int count) {
+  T* p = (T*)arena_alloc(a, count * sizeof(T), alignof(T));
+  for (int i = 0; i < count; i++) {
+    new (p + i) T();
+  }
+  return p;
+}
+
+#endif  // ARENA_H
@@ -1,30 +1,62 @@
 #include "collision.h"
+#include <stddef.h>
 #include "math_util.h"
-#include "stdio.h"
+#include "profile.h"
 
-int solveSimplex2(simplex_vertex* simplex, float32* divisor, vec2 target);
-int solveSimplex3(simplex_vertex* simplex, float32* divisor, vec2 target);
 vec2 getSearchDirection(simplex_vertex* simplex, int simplex_size);
-int getSupportPoint(const vec2* p, int len, vec2 d);
 float32 getClosestPoints(simplex_vertex* simplex, int simplex_size, float32 divisor, vec2* a,
                          vec2* b);
 
 const float32 tol = float32(0.01f);
 
-bool discreteCollision(const body* body_a, const body* body_b, feature* fa, feature* fb,
-                       vec2* impact, float32 t) {
-  printf("warning discrete collision\n");
+// per thread so that worlds stepped on different threads can report to their own sinks
+static thread_local collision_diagnostics* diagnostics = nullptr;
+
+collision_diagnostics* set_collision_diagnostics(collision_diagnostics* sink) {
+  collision_diagnostics* previous = diagnostics;
+  diagnostics = sink;
+  return previous;
+}
+
+static void report(collision_diagnostic reason, const body* body_a, const body* body_b) {
+  if (!diagnostics) {
+    return;
+  }
+  diagnostics->counts[reason]++;
+  if (diagnostics->callback) {
+    diagnostics->callback(reason, body_a->id, body_b->id, diagnostics->user);
+  }
+}
+
+// work done by one continuous_collision call, recorded when it goes out of scope
+struct ccdStats {
+  uint32_t advancements = 0;
+  uint32_t bisections = 0;
+#ifdef JUMPHYSICS_PROFILE
+  ~ccdStats() {
+    profile_record(PROF_CCD_ADVANCEMENTS, advancements);
+    profile_record(PROF_CCD_BISECTIONS, bisections);
+  }
+#endif
+};
+
+bool discreteCollision(const body* body_a, const shape* shape_a, const body* body_b,
+                       const shape* shape_b, feature* fa, feature* fb, vec2* impact, float32 t) {
+  PROFILE_COUNT(PROF_DISCRETE_FALLBACKS);
+  report(DIAG_DISCRETE_FALLBACK, body_a, body_b);
   // use separating axis theorem to move everything back to separated
   // then call GJK to get features and return with time = 0
-  vec2 mv;
-  float32 md;
-  int a_len = body_a->num_vertices;
-  int b_len = body_b->num_vertices;
-  vec2 polygon_a[a_len];
-  vec2 polygon_b[b_len];
-  get_absolute_vertices(body_a, polygon_a, t);
-  get_absolute_vertices(body_b, polygon_b, t);
-  assert(separating_axis_intersect(polygon_a, a_len, polygon_b, b_len, &mv, &md));
+  vec2 mv = {float32(0), float32(0)};
+  float32 md = float32(0);
+  int a_len = shape_a->num_vertices;
+  int b_len = shape_b->num_vertices;
+  vec2 polygon_a[MAX_VERTICES];
+  vec2 polygon_b[MAX_VERTICES];
+  get_absolute_vertices(body_a, shape_a, polygon_a, t);
+  get_absolute_vertices(body_b, shape_b, polygon_b, t);
+  bool overlap = separating_axis_intersect(polygon_a, a_len, polygon_b, b_len, &mv, &md);
+  assert(overlap);
+  (void)overlap;
   // move the object with a lower mass (infinite mass objects never get moved)
   if (body_a->inv_mass < body_b->inv_mass) {
     for (int i = 0; i < b_len; i++) {
@@ -38,58 +70,314 @@ bool discreteCollision(const body* body_a, const body* body_b, feature* fa, feat
 
   float32 distance = polygon_distance(polygon_a, a_len, polygon_b, b_len, impact, NULL, fa, fb);
   if (distance == 0) {
-    printf("warning discrete collision after separating axis distance still 0 %f\n", (float)distance);
+    report(DIAG_DISCRETE_STILL_TOUCHING, body_a, body_b);
   }
-  // printf("discrete distance: %f\n", distance);
   return true;
 }
 
+// side of the edge feature f from vertex index_1 to index_2 of a polygon its outside is on. the
+// vertices are counterclockwise so it is on the right going to the next vertex. the body center is
+// only a fallback, the children of a compound don't have to contain it
+static bool outsideLeft(const body* b, const shape* s, feature f, vec2 edge0, vec2 edge,
+                        float32 t) {
+  int n = s->num_vertices;
+  if (f.index_2 == (f.index_1 + 1) % n) {
+    return false;
+  }
+  if (f.index_1 == (f.index_2 + 1) % n) {
+    return true;
+  }
+  return cross(edge, edge0 - get_center(b, t)) > float32(0);
+}
+
+// outward normal of an edge feature at time t. a capsule's core is a bare segment without an
+// inside, its normal faces the side given by left, which the caller fixes for the whole sweep
+static vec2 edgeNormal(const body* b, const shape* s, feature f, vec2 edge0, vec2 edge, float32 t,
+                       bool left) {
+  if (s->num_vertices > 2) {
+    left = outsideLeft(b, s, f, edge0, edge, t);
+  }
+  return normalize(left ? cross(float32(1), edge) : cross(edge, float32(1)));
+}
+
+// point on the surface of A between two core points the roundings apart
+static vec2 surfacePoint(vec2 core_a, vec2 core_b, float32 rounding_a) {
+  vec2 d = core_b - core_a;
+  float32 length = magnitude(d);
+  return length > float32(0) ? core_a + (rounding_a / length) * d : core_a;
+}
+
+// pose of a body at times during the step as the sweeps sample it. polynomial sampling rotates
+// the vertices to the start of the step once and turns them from there by the angle swept until
+// t, with sine and cosine from their Taylor series up to the angle^9 and angle^10 terms. up to an
+// angle of 1 these are off by less than 1/11! = 2.5e-8 and 1/12! = 2.1e-9, below the float32
+// resolution of values near 1, so a vertex moves by rounding only. fewer terms are not enough:
+// the sweeps branch on separations within tol, and errors of 1/9! already changed impacts by
+// 2e-2 at an angle of 1. bodies turning faster than 1 per step are sampled exactly
+struct sweptBody {
+  const body* b;
+  const shape* s;
+  bool polynomial;
+  vec2 start[MAX_VERTICES];  // vertices at the start rotation, relative to the center
+};
+
+// 1/2!, 1/4!, 1/6!, 1/8!, 1/10! and 1/3!, 1/5!, 1/7!, 1/9!
+static const float32 cos_terms[5] = {float32(1.0f / 2), float32(1.0f / 24), float32(1.0f / 720),
+                                     float32(1.0f / 40320), float32(1.0f / 3628800)};
+static const float32 sin_terms[4] = {float32(1.0f / 6), float32(1.0f / 120),
+                                     float32(1.0f / 5040), float32(1.0f / 362880)};
+
+static void initSweptBody(sweptBody* swept, const body* b, const shape* s,
+                          rotation_sampling rotation) {
+  swept->b = b;
+  swept->s = s;
+  swept->polynomial = rotation == ROTATION_POLYNOMIAL && abs(b->w) <= float32(1);
+  if (swept->polynomial) {
+    mat22 rot;
+    rot.set(b->r);
+    for (int i = 0; i < s->num_vertices; i++) {
+      swept->start[i] = mul(rot, s->vertices[i]);
+    }
+  }
+}
+
+// cosine and sine of the angle swept until t
+static void sweptTurn(const sweptBody* swept, float32 t, float32* c, float32* s) {
+  const float32* ct = cos_terms;
+  const float32* st = sin_terms;
+  float32 d = t * swept->b->w;
+  float32 d2 = d * d;
+  *c = float32(1) - d2 * (ct[0] - d2 * (ct[1] - d2 * (ct[2] - d2 * (ct[3] - d2 * ct[4]))));
+  *s = d * (float32(1) - d2 * (st[0] - d2 * (st[1] - d2 * (st[2] - d2 * st[3]))));
+}
+
+static vec2 sweptVertex(const sweptBody* swept, int index, float32 t) {
+  if (!swept->polynomial) {
+    return get_absolute_vertex(swept->b, swept->s, index, t);
+  }
+  float32 c, s;
+  sweptTurn(swept, t, &c, &s);
+  vec2 u = swept->start[index];
+  return vec2(c * u.x - s * u.y, s * u.x + c * u.y) + get_center(swept->b, t);
+}
+
+static void sweptVertices(const sweptBody* swept, vec2* v, float32 t) {
+  if (!swept->polynomial) {
+    get_absolute_vertices(swept->b, swept->s, v, t);
+    return;
+  }
+  float32 c, s;
+  sweptTurn(swept, t, &c, &s);
+  vec2 center = get_center(swept->b, t);
+  for (int i = 0; i < swept->s->num_vertices; i++) {
+    vec2 u = swept->start[i];
+    v[i] = vec2(c * u.x - s * u.y, s * u.x + c * u.y) + center;
+  }
+}
+
+// conservative advancement for two bodies that don't rotate. the vertices only translate so they
+// are rotated once, and the supports along a fixed axis never change, the separation along it is
+// linear in t and the time it reaches the target is solved for directly instead of bisected.
+// polygon_a and polygon_b hold the vertices at t1 and the features are the closest ones there
+static bool translatingCollision(const body* body_a, const shape* shape_a, const body* body_b,
+                                 const shape* shape_b, vec2* polygon_a, vec2* polygon_b,
+                                 feature feature_a, feature feature_b, float32 t1, ccdStats* stats,
+                                 float32* impact_time, feature* fa, feature* fb, vec2* impact) {
+  PROFILE_COUNT(PROF_CCD_TRANSLATING);
+  int a_len = shape_a->num_vertices;
+  int b_len = shape_b->num_vertices;
+  float32 target = shape_a->rounding + shape_b->rounding;
+  bool rounded = target > float32(0) || a_len < 3 || b_len < 3;
+  vec2 local_a[MAX_VERTICES];
+  vec2 local_b[MAX_VERTICES];
+  mat22 rot;
+  rot.set(body_a->r);
+  for (int i = 0; i < a_len; i++) {
+    local_a[i] = mul(rot, shape_a->vertices[i]);
+  }
+  rot.set(body_b->r);
+  for (int i = 0; i < b_len; i++) {
+    local_b[i] = mul(rot, shape_b->vertices[i]);
+  }
+  vec2 dv = body_b->vel - body_a->vel;
+  vec2 closest_a, closest_b;
+
+  for (int iter = 0; iter < 20; iter++) {
+    stats->advancements++;
+    // separation axis from a to b, fixed by the closest features at t1
+    vec2 u, point;
+    if (!feature_a.edge && !feature_b.edge) {
+      vec2 a0 = polygon_a[feature_a.index_1];
+      vec2 b0 = polygon_b[feature_b.index_1];
+      if (magnitude(b0 - a0) - target < tol) {
+        *impact_time = t1;
+        *impact = rounded ? surfacePoint(a0, b0, shape_a->rounding) : b0;
+        *fa = feature_a;
+        *fb = feature_b;
+        PROFILE_COUNT(PROF_CCD_HITS);
+        return true;
+      }
+      u = normalize(b0 - a0);
+      point = rounded ? shape_a->rounding * u + a0 : b0;
+    } else if (feature_a.edge) {
+      vec2 edge0 = polygon_a[feature_a.index_1];
+      vec2 edge = polygon_a[feature_a.index_2] - edge0;
+      point = polygon_b[feature_b.index_1];
+      bool left = dot(cross(float32(1), edge), point - edge0) > float32(0);
+      u = edgeNormal(body_a, shape_a, feature_a, edge0, edge, t1, left);
+      point -= shape_b->rounding * u;
+    } else {
+      vec2 edge0 = polygon_b[feature_b.index_1];
+      vec2 edge = polygon_b[feature_b.index_2] - edge0;
+      point = polygon_a[feature_a.index_1];
+      bool left = dot(cross(float32(1), edge), point - edge0) > float32(0);
+      u = -edgeNormal(body_b, shape_b, feature_b, edge0, edge, t1, left);
+      point += shape_a->rounding * u;
+    }
+    int index_a = getSupportPoint(polygon_a, a_len, u);
+    int index_b = getSupportPoint(polygon_b, b_len, -u);
+    float32 s1 = dot(polygon_b[index_b] - polygon_a[index_a], u) - target;
+    if (s1 < tol) {
+      *impact_time = t1;
+      *impact = point;
+      *fa = feature_a;
+      *fb = feature_b;
+      PROFILE_COUNT(PROF_CCD_HITS);
+      return true;
+    }
+
+    float32 rate = dot(dv, u);
+    float32 s2 = s1 + (float32(1) - t1) * rate;
+    if (s2 > tol) {
+      return false;  // deepest points don't reach the plane by the end of the step
+    }
+    // land halfway into the tolerance so the shapes are still apart at the new t1, s1 >= tol
+    // above s2 so rate is negative whenever the root is solved for
+    float32 half_tol = float32(0.5f) * tol;
+    t1 = s2 < half_tol ? t1 + (s1 - half_tol) / -rate : float32(1);
+
+    vec2 center_a = get_center(body_a, t1);
+    vec2 center_b = get_center(body_b, t1);
+    for (int i = 0; i < a_len; i++) {
+      polygon_a[i] = local_a[i] + center_a;
+    }
+    for (int i = 0; i < b_len; i++) {
+      polygon_b[i] = local_b[i] + center_b;
+    }
+
+    feature next_a, next_b;
+    float32 distance = polygon_distance(polygon_a, a_len, polygon_b, b_len, &closest_a,
+                                        &closest_b, &next_a, &next_b);
+    if (distance == float32(0)) {
+      // rounding in the root can leave polygons touching, a real overlap means it went too deep
+      vec2 min_vector;
+      float32 min_overlap;
+      if (rounded || (separating_axis_intersect(polygon_a, a_len, polygon_b, b_len, &min_vector,
+                                                &min_overlap) &&
+                      min_overlap >= tol)) {
+        report(DIAG_TOO_DEEP, body_a, body_b);
+        return false;
+      }
+      *impact_time = t1;
+      *impact = feature_a.edge ? polygon_b[feature_b.index_1] : polygon_a[feature_a.index_1];
+      *fa = feature_a;
+      *fb = feature_b;
+      PROFILE_COUNT(PROF_CCD_HITS);
+      return true;
+    }
+    feature_a = next_a;
+    feature_b = next_b;
+    if (rounded && distance < target + tol) {
+      *impact_time = t1;
+      *impact = surfacePoint(closest_a, closest_b, shape_a->rounding);
+      *fa = feature_a;
+      *fb = feature_b;
+      PROFILE_COUNT(PROF_CCD_HITS);
+      return true;
+    }
+  }
+
+  PROFILE_COUNT(PROF_ADVANCEMENT_LIMIT);
+  report(DIAG_ADVANCEMENT_LIMIT, body_a, body_b);
+  return false;
+}
+
 // Bilateral advancement algorithm as explained in https://box2d.org/files/ErinCatto_ContinuousCollision_GDC2013.pdf
-bool continuous_collision(const body* body_a, const body* body_b, float32* impact_time, feature* fa,
-                         feature* fb, vec2* impact, float32 start_time) {
-  int a_len = body_a->num_vertices;
-  int b_len = body_b->num_vertices;
-  vec2 polygon_a[a_len];
-  vec2 polygon_b[b_len];
+bool continuous_collision(const body* body_a, const shape* shape_a, const body* body_b,
+                          const shape* shape_b, float32* impact_time, feature* fa, feature* fb,
+                          vec2* impact, float32 start_time, rotation_sampling rotation) {
+  PROFILE_COUNT(PROF_CCD_QUERIES);
+  ccdStats stats;
+  int a_len = shape_a->num_vertices;
+  int b_len = shape_b->num_vertices;
+  vec2 polygon_a[MAX_VERTICES];
+  vec2 polygon_b[MAX_VERTICES];
   feature feature_a, feature_b;
   vec2 closest_a, closest_b;
   float32 distance;
 
   float32 t1 = start_time;
   float32 t2 = 0;
+  sweptBody swept_a, swept_b;
+  initSweptBody(&swept_a, body_a, shape_a, rotation);
+  initSweptBody(&swept_b, body_b, shape_b, rotation);
 
-  get_absolute_vertices(body_a, polygon_a, t1);
-  get_absolute_vertices(body_b, polygon_b, t1);
+  sweptVertices(&swept_a, polygon_a, t1);
+  sweptVertices(&swept_b, polygon_b, t1);
 
   distance = polygon_distance(polygon_a, a_len, polygon_b, b_len, &closest_a, &closest_b, &feature_a,
                              &feature_b);
 
+  // rounded shapes collide when their cores come within the sum of the roundings, so every
+  // separation below is measured against target instead of zero
+  float32 target = shape_a->rounding + shape_b->rounding;
+  bool rounded = target > float32(0) || a_len < 3 || b_len < 3;
+  if (rounded && distance < target + tol) {
+    // already touching. overlapping cores have no useful closest points, the centers stand in
+    *impact_time = t1;
+    *fa = feature_a;
+    *fb = feature_b;
+    *impact = distance == float32(0)
+                  ? float32(0.5f) * (get_center(body_a, t1) + get_center(body_b, t1))
+                  : surfacePoint(closest_a, closest_b, shape_a->rounding);
+    PROFILE_COUNT(PROF_CCD_HITS);
+    return true;
+  }
+
   // early exit for already overlapping
   if (distance == 0) {
     // at 0 already collided something failed, handle with discrete collision
     vec2 imp;
-    discreteCollision(body_a, body_b, &feature_a, &feature_b, &imp, t1);
+    discreteCollision(body_a, shape_a, body_b, shape_b, &feature_a, &feature_b, &imp, t1);
     *impact_time = t1;
     *fa = feature_a;
     *fb = feature_b;
     *impact = imp;
+    PROFILE_COUNT(PROF_CCD_HITS);
     return true;
   }
 
+  if (body_a->w == float32(0) && body_b->w == float32(0)) {
+    return translatingCollision(body_a, shape_a, body_b, shape_b, polygon_a, polygon_b, feature_a,
+                                feature_b, t1, &stats, impact_time, fa, fb, impact);
+  }
+
   int iter = 0;
   while (iter < 20) {
+    stats.advancements++;
     if ((!feature_a.edge) && (!feature_b.edge)) {  // point to point
       // separation function depends on separating axis u which is calculated
       // from feature a to b at time 0 and is fixed
       vec2 a0, b0;
-      a0 = get_absolute_vertex(body_a, feature_a.index_1, t1);
-      b0 = get_absolute_vertex(body_b, feature_b.index_1, t1);
+      a0 = sweptVertex(&swept_a, feature_a.index_1, t1);
+      b0 = sweptVertex(&swept_b, feature_b.index_1, t1);
       vec2 u = b0 - a0;  // seperation axis,
-      if (magnitude(u) < tol) {
+      if (magnitude(u) - target < tol) {
         *impact_time = t1;
-        *impact = b0;
+        *impact = rounded ? surfacePoint(a0, b0, shape_a->rounding) : b0;
         *fa = feature_a;
         *fb = feature_b;
+        PROFILE_COUNT(PROF_CCD_HITS);
         return true;  // time of impact is t1
       }
       u = normalize(u);  // length of u is guaranteed != 0 so this is okay
@@ -98,19 +386,17 @@ bool continuous_collision(const body* body_a, const body* body_b, float32* impac
 
       while (1) {
         // get polygon for selected time
-        get_absolute_vertices(body_a, polygon_a, t2);
-        get_absolute_vertices(body_b, polygon_b, t2);
+        sweptVertices(&swept_a, polygon_a, t2);
+        sweptVertices(&swept_b, polygon_b, t2);
         // find deepest points
-        int index_a = getSupportPoint(polygon_a, body_a->num_vertices, u);
-        int index_b = getSupportPoint(polygon_b, body_b->num_vertices, -u);
+        int index_a = getSupportPoint(polygon_a, shape_a->num_vertices, u);
+        int index_b = getSupportPoint(polygon_b, shape_b->num_vertices, -u);
 
         // calculate s
-        float32 s = dot(polygon_b[index_b] - polygon_a[index_a], u);
-        // printf("point-point separation: %f\n", s);
+        float32 s = dot(polygon_b[index_b] - polygon_a[index_a], u) - target;
 
         if (s > tol) {
           // deepest points are not past the plane, polygons do not collide
-          // printf("deepest points are not past the plane, polygons do not collide\n");
           return false;
         } else if (s < -tol) {
           float32 a, b, c;
@@ -120,10 +406,9 @@ bool continuous_collision(const body* body_a, const body* body_b, float32* impac
           int b_iter = 0;
           while (1) {
             c = (a + b) / 2;
-            get_absolute_vertices(body_a, polygon_a, c);
-            get_absolute_vertices(body_b, polygon_b, c);
-            s = dot(polygon_b[index_b] - polygon_a[index_a], u);
-            // printf("[%d]: s %f, a %f, b %f, c %f\n", b_iter, s, a, b, c);
+            sweptVertices(&swept_a, polygon_a, c);
+            sweptVertices(&swept_b, polygon_b, c);
+            s = dot(polygon_b[index_b] - polygon_a[index_a], u) - target;
             if (abs(s) < tol) {  // root found
               break;
             } else if (s > 0) {
@@ -132,8 +417,10 @@ bool continuous_collision(const body* body_a, const body* body_b, float32* impac
               b = c;
             }
             b_iter++;
+            stats.bisections++;
             if (b_iter > 20) {
-              printf("warning bisection root finding iterations exceeded");
+              PROFILE_COUNT(PROF_BISECTION_LIMIT);
+              report(DIAG_BISECTION_LIMIT, body_a, body_b);
               return false;
             }
           }
@@ -145,66 +432,55 @@ bool continuous_collision(const body* body_a, const body* body_b, float32* impac
         }
       }
     } else {  // point to edge
-      const body* body_edge;
-      const body* body_point;
-      feature feature_edge;
-      feature feature_point;
-      // redefine bodies and points so that either a or b can be used as either
-      if (feature_a.edge && !feature_b.edge) {
-        body_edge = body_a;
-        feature_edge = feature_a;
-
-        body_point = body_b;
-        feature_point = feature_b;
-      } else if (feature_b.edge && !feature_a.edge) {
-        body_edge = body_b;
-        feature_edge = feature_b;
-
-        body_point = body_a;
-        feature_point = feature_a;
-      } else {
+      if (feature_a.edge && feature_b.edge) {
         assert(false);  // should never be given an edge-edge case from polygon_distance
+        return false;
       }
-      int point_len = body_point->num_vertices;
-      vec2 polygon_point[point_len];
+      // redefine bodies and points so that either a or b can be used as either
+      bool edge_a = feature_a.edge;
+      const body* body_edge = edge_a ? body_a : body_b;
+      const sweptBody* swept_edge = edge_a ? &swept_a : &swept_b;
+      const shape* shape_edge = edge_a ? shape_a : shape_b;
+      feature feature_edge = edge_a ? feature_a : feature_b;
+
+      const sweptBody* swept_point = edge_a ? &swept_b : &swept_a;
+      const shape* shape_point = edge_a ? shape_b : shape_a;
+      feature feature_point = edge_a ? feature_b : feature_a;
+      vec2 polygon_point[MAX_VERTICES];
 
       vec2 edge0, edge1, point;
-      edge0 = get_absolute_vertex(body_edge, feature_edge.index_1, t1);
-      edge1 = get_absolute_vertex(body_edge, feature_edge.index_2, t1);
-      point = get_absolute_vertex(body_point, feature_point.index_1, t1);
+      edge0 = sweptVertex(swept_edge, feature_edge.index_1, t1);
+      edge1 = sweptVertex(swept_edge, feature_edge.index_2, t1);
+      point = sweptVertex(swept_point, feature_point.index_1, t1);
 
       vec2 edge = edge1 - edge0;
       // make normal positive facing out of polygon
-      vec2 n = cross(edge, edge0 - get_center(body_edge, t1)) > 0 ? cross(1, edge) : cross(edge, 1);
-      n = normalize(n);
+      bool left = dot(cross(float32(1), edge), point - edge0) > float32(0);
+      vec2 n = edgeNormal(body_edge, shape_edge, feature_edge, edge0, edge, t1, left);
       // dot(a0,n) = dot(a1,n) is the offset of the plane in the normal axis from origin
-      float32 s = dot(point, n) - dot(edge0, n);
-
-      // printf("edge-point separation: %f, dot(b0, n) = %f, dot(a0, n) = %f \n", s, dot(point, n),
-      //        dot(edge0, n));
+      float32 s = dot(point, n) - dot(edge0, n) - target;
 
       if (abs(s) < tol) {
         *impact_time = t1;
-        *impact = closest_a;
+        *impact = point - shape_point->rounding * n;
         *fa = feature_a;
         *fb = feature_b;
+        PROFILE_COUNT(PROF_CCD_HITS);
         return true;
       }
 
       t2 = float32(1);
       while (1) {
         // get plane determined earlier at new time t2
-        edge0 = get_absolute_vertex(body_edge, feature_edge.index_1, t2);
-        edge1 = get_absolute_vertex(body_edge, feature_edge.index_2, t2);
+        edge0 = sweptVertex(swept_edge, feature_edge.index_1, t2);
+        edge1 = sweptVertex(swept_edge, feature_edge.index_2, t2);
         edge = edge1 - edge0;
-        vec2 n =
-            cross(edge, edge0 - get_center(body_edge, t2)) > 0 ? cross(1, edge) : cross(edge, 1);
-        n = normalize(n);
+        vec2 n = edgeNormal(body_edge, shape_edge, feature_edge, edge0, edge, t2, left);
         // have to get all points of the polygon that doesn't make up the plane
         // in order to find the deepest point relative to the plane
-        get_absolute_vertices(body_point, polygon_point, t2);
-        int point_index = getSupportPoint(polygon_point, body_point->num_vertices, -n);
-        s = dot(polygon_point[point_index], n) - dot(edge0, n);
+        sweptVertices(swept_point, polygon_point, t2);
+        int point_index = getSupportPoint(polygon_point, shape_point->num_vertices, -n);
+        s = dot(polygon_point[point_index], n) - dot(edge0, n) - target;
 
         if (s > tol) {
           return false;
@@ -218,17 +494,14 @@ bool continuous_collision(const body* body_a, const body* body_b, float32* impac
           while (1) {
             c = (a + b) / float32(2);
             // get plane determined earlier at new time t2
-            edge0 = get_absolute_vertex(body_edge, feature_edge.index_1, c);
-            edge1 = get_absolute_vertex(body_edge, feature_edge.index_2, c);
+            edge0 = sweptVertex(swept_edge, feature_edge.index_1, c);
+            edge1 = sweptVertex(swept_edge, feature_edge.index_2, c);
             edge = edge1 - edge0;
-            n = cross(edge, edge0 - get_center(body_edge, c)) > float32(0) ? cross(float32(1), edge)
-                                                                          : cross(edge, float32(1));
-            n = normalize(n);
+            n = edgeNormal(body_edge, shape_edge, feature_edge, edge0, edge, c, left);
             // have to get all points of the polygon that doesn't make up the plane
             // in order to find the deepest point relative to the plane
-            get_absolute_vertices(body_point, polygon_point, c);
-            s = dot(polygon_point[point_index], n) - dot(edge0, n);
-            // printf("[%d]: n [%f,%f] s %f, a %f, b %f, c %f\n", b_iter, n.x, n.y, s, a, b, c);
+            sweptVertices(swept_point, polygon_point, c);
+            s = dot(polygon_point[point_index], n) - dot(edge0, n) - target;
             if (abs(s) < tol) {  // root found
               break;
             } else if (s > float32(0)) {
@@ -237,8 +510,10 @@ bool continuous_collision(const body* body_a, const body* body_b, float32* impac
               b = c;
             }
             b_iter++;
+            stats.bisections++;
             if (b_iter > 20) {
-              printf("warning bisection root finding iterations exceeded");
+              PROFILE_COUNT(PROF_BISECTION_LIMIT);
+              report(DIAG_BISECTION_LIMIT, body_a, body_b);
               return false;
               // assert(false);
             }
@@ -252,8 +527,28 @@ bool continuous_collision(const body* body_a, const body* body_b, float32* impac
         }
       }
     }
-    get_absolute_vertices(body_a, polygon_a, t1);
-    get_absolute_vertices(body_b, polygon_b, t1);
+    sweptVertices(&swept_a, polygon_a, t1);
+    sweptVertices(&swept_b, polygon_b, t1);
+
+    if (rounded) {
+      // the cores stay apart, GJK gives the distance between them directly
+      distance = polygon_distance(polygon_a, a_len, polygon_b, b_len, &closest_a, &closest_b,
+                                  &feature_a, &feature_b);
+      if (distance == float32(0)) {
+        report(DIAG_TOO_DEEP, body_a, body_b);
+        return false;
+      }
+      if (distance < target + tol) {
+        *impact_time = t1;
+        *impact = surfacePoint(closest_a, closest_b, shape_a->rounding);
+        *fa = feature_a;
+        *fb = feature_b;
+        PROFILE_COUNT(PROF_CCD_HITS);
+        return true;
+      }
+      iter++;
+      continue;
+    }
 
     // GJK algorithm returns 0 for distance if the shapes are overlapping
     // no matter how much they overlap by and the closest features are not accurate
@@ -263,16 +558,18 @@ bool continuous_collision(const body* body_a, const body* body_b, float32* impac
     vec2 min_vector;
     float32 min_overlap;
     if (separating_axis_intersect(polygon_a, a_len, polygon_b, b_len, &min_vector, &min_overlap)) {
-      // printf("min_overlap %f\n", min_overlap);
       if (min_overlap < tol) {
         *impact_time = t1;
-        *impact = closest_a;
+        // vertex of the point feature at the time of impact
+        *impact = feature_a.edge ? sweptVertex(&swept_b, feature_b.index_1, t1)
+                                 : sweptVertex(&swept_a, feature_a.index_1, t1);
         *fa = feature_a;
         *fb = feature_b;
+        PROFILE_COUNT(PROF_CCD_HITS);
         return true;
       } else {
         // somehow we went too deep, should never hit this
-        printf("warning went too deep\n");
+        report(DIAG_TOO_DEEP, body_a, body_b);
         return false;
       }
     }
@@ -287,15 +584,91 @@ bool continuous_collision(const body* body_a, const body* body_b, float32* impac
     iter++;
   }
 
-  printf("warning maxed out overall bilateral advancement iterations\n");
+  PROFILE_COUNT(PROF_ADVANCEMENT_LIMIT);
+  report(DIAG_ADVANCEMENT_LIMIT, body_a, body_b);
   return false;
 }
 
+// outward facing unit normal of the edge feature f of b at time t
+static vec2 outwardNormal(const body* b, const shape* s, feature f, float32 t) {
+  vec2 v0 = get_absolute_vertex(b, s, f.index_1, t);
+  vec2 v1 = get_absolute_vertex(b, s, f.index_2, t);
+  vec2 n = normalize(v0, v1);
+  return outsideLeft(b, s, f, v0, v1 - v0, t) ? n : -n;
+}
+
+// apply collision impulse at time t, impact is the point of contact returned by continuous_collision
+// velocities change at time t so centers and angles are shifted to keep the positions at t unchanged
+void handle_collision(body* body_a, const shape* shape_a, body* body_b, const shape* shape_b,
+                      feature fa, feature fb, vec2 impact, float32 t, float32 restitution) {
+  // a capsule's segment has no outward side, its edges use the centers like points do
+  vec2 n;
+  if (fa.edge && shape_a->num_vertices > 2) {
+    n = outwardNormal(body_a, shape_a, fa, t);
+  } else if (fb.edge && shape_b->num_vertices > 2) {
+    n = -outwardNormal(body_b, shape_b, fb, t);
+  } else {
+    // point to point, points are within tol of each other (or of the roundings) so fall back to
+    // the centers
+    n = get_center(body_b, t) - get_center(body_a, t);
+    if (dot(n, n) == float32(0)) {
+      return;
+    }
+    n = normalize(n);
+  }
+
+  vec2 ra = impact - get_center(body_a, t);
+  vec2 rb = impact - get_center(body_b, t);
+  vec2 dv = body_b->vel + cross(body_b->w, rb) - body_a->vel - cross(body_a->w, ra);
+  float32 vn = dot(dv, n);
+  if (vn >= float32(0)) {
+    return;  // already separating
+  }
+
+  float32 rna = cross(ra, n);
+  float32 rnb = cross(rb, n);
+  float32 kn = body_a->inv_mass + body_b->inv_mass + body_a->inv_I * rna * rna +
+               body_b->inv_I * rnb * rnb;
+  if (kn == float32(0)) {
+    return;
+  }
+  float32 jn = -(float32(1) + restitution) * vn / kn;
+
+  // coulomb friction along the tangent, limited by the normal impulse
+  vec2 tangent = cross(n, float32(1));
+  float32 rta = cross(ra, tangent);
+  float32 rtb = cross(rb, tangent);
+  float32 kt = body_a->inv_mass + body_b->inv_mass + body_a->inv_I * rta * rta +
+               body_b->inv_I * rtb * rtb;
+  float32 jt = float32(0);
+  if (kt > float32(0)) {
+    float32 mu = sqrt(body_a->friction * body_b->friction);
+    jt = clamp(-dot(dv, tangent) / kt, -mu * jn, mu * jn);
+  }
+  vec2 p = jn * n + jt * tangent;
+
+  vec2 dva = -(body_a->inv_mass * p);
+  float32 dwa = -(body_a->inv_I * cross(ra, p));
+  vec2 dvb = body_b->inv_mass * p;
+  float32 dwb = body_b->inv_I * cross(rb, p);
+
+  body_a->vel += dva;
+  body_a->w += dwa;
+  body_a->center -= t * dva;
+  body_a->r -= t * dwa;
+
+  body_b->vel += dvb;
+  body_b->w += dwb;
+  body_b->center -= t * dvb;
+  body_b->r -= t * dwb;
+}
+
 // 2D GJK, explanation: https://box2d.org/files/ErinCatto_GJK_GDC2010.pdf
 // get closest distance between two polygons
 // closest point on each polygon is returned through optional params closest_a and closest_b
 float32 polygon_distance(const vec2* polygon_a, int len_a, const vec2* polygon_b, int len_b,
                         vec2* closest_a, vec2* closest_b, feature* feature_a, feature* feature_b) {
+  PROFILE_COUNT(PROF_GJK_QUERIES);
   simplex_vertex simplex[3];
   int simplex_size = 1;                       // number of simplex vertices
   vec2 origin{float32(0.0f), float32(0.0f)};  // origin is our target
@@ -378,6 +751,10 @@ float32 polygon_distance(const vec2* polygon_a, int len_a, const vec2* polygon_b
 
     simplex_size++;
   }
+  PROFILE_RECORD(PROF_GJK_ITERATIONS, iter);
+  if (iter == 20) {
+    PROFILE_COUNT(PROF_GJK_ITERATION_LIMIT);
+  }
 
   vec2 a, b;
   float32 distance = getClosestPoints(simplex, simplex_size, divisor, &a, &b);
@@ -642,6 +1019,7 @@ int solveSimplex3(simplex_vertex* simplex, float32* divisor, vec2 target) {
 // https://en.wikipedia.org/wiki/Hyperplane_separation_theorem#Use_in_collision_detection
 bool separating_axis_intersect(const vec2 a[], int a_len, const vec2 b[], int b_len,
                              vec2* minimum_vector, float32* minimum_overlap) {
+  PROFILE_COUNT(PROF_SAT_QUERIES);
   float32 proj_min_a;
   float32 proj_max_a;
   float32 proj_min_b;
@@ -720,6 +1098,528 @@ bool separating_axis_intersect(const vec2 a[], int a_len, const vec2 b[], int b_
   return true;
 }
 
+// keep the part of segment in[] where dot(n, p) <= offset, returns number of output points
+static int clipSegment(const vec2 in[2], vec2 out[2], int ids_in[2], int ids_out[2], vec2 n,
+                       float32 offset, int clip_id) {
+  int count = 0;
+  float32 d0 = dot(n, in[0]) - offset;
+  float32 d1 = dot(n, in[1]) - offset;
+
+  if (d0 <= float32(0)) {
+    ids_out[count] = ids_in[0];
+    out[count++] = in[0];
+  }
+  if (d1 <= float32(0)) {
+    ids_out[count] = ids_in[1];
+    out[count++] = in[1];
+  }
+  // points on opposite sides, add the intersection with the clipping plane
+  if (d0 * d1 < float32(0)) {
+    float32 s = d0 / (d0 - d1);
+    ids_out[count] = clip_id;
+    out[count++] = in[0] + s * (in[1] - in[0]);
+  }
+  return count;
+}
+
+// index of the edge of shape s whose outward normal is most aligned with d, given in shape space
+static int bestFace(const shape* s, vec2 d, float32* alignment) {
+  int best = 0;
+  float32 best_value = dot(s->normals[0], d);
+  for (int i = 1; i < s->num_vertices; i++) {
+    float32 value = dot(s->normals[i], d);
+    if (value > best_value) {
+      best_value = value;
+      best = i;
+    }
+  }
+  *alignment = best_value;
+  return best;
+}
+
+// direction from A to B of least penetration over the face normals of both cores, for cores that
+// touch or overlap and aren't both polygons. two circles fall back to the line between centers
+static vec2 overlapNormal(const vec2* polygon_a, const shape* shape_a, const mat22& rot_a,
+                          const vec2* polygon_b, const shape* shape_b, const mat22& rot_b) {
+  int a_len = shape_a->num_vertices;
+  int b_len = shape_b->num_vertices;
+  vec2 normal(float32(0), float32(1));
+  float32 best = -F32_MAX;
+  for (int i = 0; i < a_len && a_len > 1; i++) {
+    vec2 n = mul(rot_a, shape_a->normals[i]);
+    float32 separation = dot(n, polygon_b[getSupportPoint(polygon_b, b_len, -n)] - polygon_a[i]);
+    if (separation > best) {
+      best = separation;
+      normal = n;
+    }
+  }
+  for (int i = 0; i < b_len && b_len > 1; i++) {
+    vec2 n = mul(rot_b, shape_b->normals[i]);
+    float32 separation = dot(n, polygon_a[getSupportPoint(polygon_a, a_len, -n)] - polygon_b[i]);
+    if (separation > best) {
+      best = separation;
+      normal = -n;
+    }
+  }
+  if (a_len == 1 && b_len == 1) {
+    vec2 d = polygon_b[0] - polygon_a[0];
+    if (dot(d, d) > float32(0)) {
+      normal = normalize(d);
+    }
+  }
+  return normal;
+}
+
+// single contact point between rounded surfaces whose cores are closest at core_a and core_b
+// along normal, placed halfway between the surfaces
+static bool roundedPoint(vec2 core_a, vec2 core_b, vec2 normal, float32 rounding_a,
+                         float32 rounding_b, float32 margin, manifold* m) {
+  float32 separation = dot(normal, core_b - core_a) - rounding_a - rounding_b;
+  if (separation > margin) {
+    return false;
+  }
+  m->normal = normal;
+  m->point_count = 1;
+  m->points[0].point = core_a + (rounding_a + float32(0.5f) * separation) * normal;
+  m->points[0].separation = separation;
+  m->points[0].key = 0;
+  return true;
+}
+
+// clip the incident segment against the side planes of the reference face v1 v2 and keep the
+// points within margin of it. returns false if less than two points survive the clipping
+static bool clipIncident(vec2 v1, vec2 v2, vec2 ref_normal, int ref_face, const vec2 segment[2],
+                         int ids[2], bool flip, float32 ref_rounding, float32 inc_rounding,
+                         float32 margin, manifold* m) {
+  vec2 tangent = cross(ref_normal, float32(-1));
+  vec2 clip1[2], clip2[2];
+  int ids1[2], ids2[2];
+  if (clipSegment(segment, clip1, ids, ids1, -tangent, -dot(tangent, v1), MAX_VERTICES) < 2 ||
+      clipSegment(clip1, clip2, ids1, ids2, tangent, dot(tangent, v2), MAX_VERTICES + 1) < 2) {
+    return false;
+  }
+
+  m->normal = flip ? -ref_normal : ref_normal;
+  m->point_count = 0;
+  for (int i = 0; i < 2; i++) {
+    float32 separation = dot(ref_normal, clip2[i] - v1) - ref_rounding - inc_rounding;
+    if (separation <= margin) {
+      manifold_point* mp = m->points + m->point_count;
+      // halfway between the incident surface and the reference surface
+      mp->point = clip2[i] - (inc_rounding + float32(0.5f) * separation) * ref_normal;
+      mp->separation = separation;
+      mp->key = (uint32_t)ref_face | ((uint32_t)ids2[i] << 8) | ((uint32_t)flip << 16);
+      m->point_count++;
+    }
+  }
+  return true;
+}
+
+// face of a box whose outward normal is closest to d, given in box space. faces are numbered by
+// their first vertex in add_box order: -y, +x, +y, -x
+static int boxFace(vec2 d) {
+  if (abs(d.x) > abs(d.y)) {
+    return d.x > float32(0) ? 1 : 3;
+  }
+  return d.y > float32(0) ? 2 : 0;
+}
+
+// box against box, the face axes are the columns of both rotations and the support distances are
+// closed form: the half extents of one box projected through the absolute rotation between the
+// two. the face with the largest separation becomes the reference face and the incident face is
+// clipped against it like in polygon_manifold, with the same keys. returns false if the boxes are
+// further apart than margin, boxes closest at a corner clip to no point and leave m empty
+static bool boxManifold(const shape* shape_a, const mat22& rot_a, vec2 center_a,
+                        const shape* shape_b, const mat22& rot_b, vec2 center_b, float32 margin,
+                        manifold* m) {
+  vec2 ha = shape_a->half_extents;
+  vec2 hb = shape_b->half_extents;
+  // absolute rotation from B to A
+  float32 c11 = abs(dot(rot_a.column1, rot_b.column1));
+  float32 c12 = abs(dot(rot_a.column1, rot_b.column2));
+  float32 c21 = abs(dot(rot_a.column2, rot_b.column1));
+  float32 c22 = abs(dot(rot_a.column2, rot_b.column2));
+  vec2 d = center_b - center_a;
+  vec2 da = mul_transpose(rot_a, d);
+  vec2 db = mul_transpose(rot_b, d);
+
+  float32 sep_ax = abs(da.x) - ha.x - (hb.x * c11 + hb.y * c12);
+  float32 sep_ay = abs(da.y) - ha.y - (hb.x * c21 + hb.y * c22);
+  float32 sep_bx = abs(db.x) - hb.x - (ha.x * c11 + ha.y * c21);
+  float32 sep_by = abs(db.y) - hb.y - (ha.x * c12 + ha.y * c22);
+  // faces of A facing B and of B facing A
+  float32 sep_a = max(sep_ax, sep_ay);
+  float32 sep_b = max(sep_bx, sep_by);
+  if (sep_a > margin || sep_b > margin) {
+    return false;
+  }
+  int face_a = sep_ax >= sep_ay ? (da.x > float32(0) ? 1 : 3) : (da.y > float32(0) ? 2 : 0);
+  int face_b = sep_bx >= sep_by ? (db.x > float32(0) ? 3 : 1) : (db.y > float32(0) ? 0 : 2);
+
+  // prefer A as the reference like polygon_manifold
+  bool flip = sep_b > sep_a + float32(0.001f);
+  const shape* ref_shape = flip ? shape_b : shape_a;
+  const mat22& ref_rot = flip ? rot_b : rot_a;
+  vec2 ref_center = flip ? center_b : center_a;
+  int ref_face = flip ? face_b : face_a;
+  const shape* inc_shape = flip ? shape_a : shape_b;
+  const mat22& inc_rot = flip ? rot_a : rot_b;
+  vec2 inc_center = flip ? center_a : center_b;
+
+  vec2 ref_normal = mul(ref_rot, ref_shape->normals[ref_face]);
+  vec2 v1 = mul(ref_rot, ref_shape->vertices[ref_face]) + ref_center;
+  vec2 v2 = mul(ref_rot, ref_shape->vertices[(ref_face + 1) & 3]) + ref_center;
+  int inc_face = boxFace(mul_transpose(inc_rot, -ref_normal));
+  int ids[2] = {inc_face, (inc_face + 1) & 3};
+  vec2 segment[2] = {mul(inc_rot, inc_shape->vertices[ids[0]]) + inc_center,
+                     mul(inc_rot, inc_shape->vertices[ids[1]]) + inc_center};
+
+  if (!clipIncident(v1, v2, ref_normal, ref_face, segment, ids, flip, float32(0), float32(0),
+                    margin, m)) {
+    m->point_count = 0;
+  }
+  return true;
+}
+
+// contact normal from GJK closest points, or from SAT when the polygons touch or overlap
+// the face of either polygon that best matches it becomes the reference face and the
+// most anti-parallel face of the other polygon is clipped against its side planes
+bool polygon_manifold(const body* body_a, const shape* shape_a, const body* body_b,
+                      const shape* shape_b, float32 margin, float32 t, manifold* m) {
+  int a_len = shape_a->num_vertices;
+  int b_len = shape_b->num_vertices;
+  mat22 rot_a, rot_b;
+  rot_a.set(body_a->r + t * body_a->w);
+  rot_b.set(body_b->r + t * body_b->w);
+  vec2 center_a = get_center(body_a, t);
+  vec2 center_b = get_center(body_b, t);
+  if (shape_a->box && shape_b->box) {
+    // corners are left to the general path below
+    if (!boxManifold(shape_a, rot_a, center_a, shape_b, rot_b, center_b, margin, m)) {
+      return false;
+    }
+    if (m->point_count > 0) {
+      return true;
+    }
+  }
+  vec2 polygon_a[MAX_VERTICES];
+  vec2 polygon_b[MAX_VERTICES];
+  for (int i = 0; i < a_len; i++) {
+    polygon_a[i] = mul(rot_a, shape_a->vertices[i]) + center_a;
+  }
+  for (int i = 0; i < b_len; i++) {
+    polygon_b[i] = mul(rot_b, shape_b->vertices[i]) + center_b;
+  }
+
+  // the cores of rounded shapes keep the sum of the roundings apart, the contact logic works on
+  // the cores and moves the points out to the surfaces
+  float32 rounding_a = shape_a->rounding;
+  float32 rounding_b = shape_b->rounding;
+  float32 radii = rounding_a + rounding_b;
+  bool rounded = radii > float32(0) || a_len < 3 || b_len < 3;
+
+  vec2 closest_a, closest_b;
+  float32 distance = polygon_distance(polygon_a, a_len, polygon_b, b_len, &closest_a, &closest_b,
+                                      NULL, NULL);
+  if (distance - radii > margin) {
+    return false;
+  }
+
+  // closest points are too noisy to give a direction when the polygons are (nearly) touching
+  vec2 normal;
+  if (distance > tol) {
+    normal = (float32(1) / distance) * (closest_b - closest_a);
+  } else if (a_len < 3 || b_len < 3) {
+    normal = overlapNormal(polygon_a, shape_a, rot_a, polygon_b, shape_b, rot_b);
+  } else {
+    vec2 mv;
+    float32 md;
+    if (separating_axis_intersect(polygon_a, a_len, polygon_b, b_len, &mv, &md)) {
+      normal = -mv;  // mv is the direction to push A out of B
+    } else if (distance > float32(0)) {
+      // apart by less than tol, continuous_collision already counts that as touching so the
+      // closest points have to do
+      normal = (float32(1) / distance) * (closest_b - closest_a);
+    } else {
+      return false;
+    }
+  }
+
+  // a circle touches with one point, found from the deepest core points along the normal
+  if (a_len == 1 || b_len == 1) {
+    vec2 deepest_a = polygon_a[getSupportPoint(polygon_a, a_len, normal)];
+    vec2 deepest_b = polygon_b[getSupportPoint(polygon_b, b_len, -normal)];
+    // keep the point on the circle, the support point of a face is either of its ends
+    if (a_len == 1) {
+      deepest_b = deepest_a + dot(normal, deepest_b - deepest_a) * normal;
+    } else {
+      deepest_a = deepest_b - dot(normal, deepest_b - deepest_a) * normal;
+    }
+    return roundedPoint(deepest_a, deepest_b, normal, rounding_a, rounding_b, margin, m);
+  }
+
+  // faces are picked with the precomputed normals, the direction is rotated into shape space
+  float32 align_a, align_b;
+  int face_a = bestFace(shape_a, mul_transpose(rot_a, normal), &align_a);
+  int face_b = bestFace(shape_b, mul_transpose(rot_b, -normal), &align_b);
+
+  // prefer A as the reference so the choice doesn't flicker for parallel faces
+  bool flip = align_b > align_a + float32(0.001f);
+  const vec2* ref = flip ? polygon_b : polygon_a;
+  const shape* ref_shape = flip ? shape_b : shape_a;
+  const mat22& ref_rot = flip ? rot_b : rot_a;
+  int ref_face = flip ? face_b : face_a;
+  const vec2* inc = flip ? polygon_a : polygon_b;
+  const shape* inc_shape = flip ? shape_a : shape_b;
+  int inc_len = inc_shape->num_vertices;
+  const mat22& inc_rot = flip ? rot_a : rot_b;
+
+  vec2 v1 = ref[ref_face];
+  vec2 v2 = ref[(ref_face + 1) % ref_shape->num_vertices];
+  vec2 ref_normal = mul(ref_rot, ref_shape->normals[ref_face]);
+
+  // rounded cores that are apart and closest at a corner, e.g. a capsule's end cap, touch at a
+  // single point that clipping against the faces would miss
+  bool corner = dot(ref_normal, flip ? -normal : normal) < float32(0.99f);
+  if (rounded && distance > tol && corner) {
+    return roundedPoint(closest_a, closest_b, normal, rounding_a, rounding_b, margin, m);
+  }
+  float32 ref_rounding = flip ? rounding_b : rounding_a;
+  float32 inc_rounding = flip ? rounding_a : rounding_b;
+
+  float32 unused;
+  int inc_face = bestFace(inc_shape, mul_transpose(inc_rot, -ref_normal), &unused);
+  vec2 segment[2] = {inc[inc_face], inc[(inc_face + 1) % inc_len]};
+  int ids[2] = {inc_face, (inc_face + 1) % inc_len};
+
+  if (!clipIncident(v1, v2, ref_normal, ref_face, segment, ids, flip, ref_rounding, inc_rounding,
+                    margin, m)) {
+    // cores closest at a corner, which speculative contacts need at any distance within margin
+    if (distance > float32(0)) {
+      return roundedPoint(closest_a, closest_b, normal, rounding_a, rounding_b, margin, m);
+    }
+    // overlapping with the incident face past the ends of the reference face, the deepest
+    // incident vertex is kept on its own
+    int deepest = getSupportPoint(inc, inc_len, -ref_normal);
+    float32 separation = dot(ref_normal, inc[deepest] - v1) - ref_rounding - inc_rounding;
+    m->normal = flip ? -ref_normal : ref_normal;
+    m->point_count = 1;
+    m->points[0].point = inc[deepest] - (inc_rounding + float32(0.5f) * separation) * ref_normal;
+    m->points[0].separation = separation;
+    m->points[0].key = (uint32_t)ref_face | ((uint32_t)deepest << 8) | ((uint32_t)flip << 16);
+    return true;
+  }
+  return m->point_count > 0;
+}
+
+// a chain turns at the corner between the edges in and out. the surface is on the left of the
+// edges so the corner sticks out of the solid where the chain turns right
+static bool convexCorner(vec2 in, vec2 out) {
+  return cross(in, out) < float32(0);
+}
+
+// open chain ends have their own vertex as ghost
+static bool openEnd(vec2 v, vec2 ghost) {
+  return v.x == ghost.x && v.y == ghost.y;
+}
+
+// a body closest to a vertex of the edge only gets a contact from the edge owning the vertex, so
+// it is never pushed twice at a corner and never catches on the vertex between two edges in line.
+// v1 is owned if the chain ends there, or if the corner is convex and the body isn't in front of
+// the next edge. v0 only at an open end, any other corner at v0 is the previous edge's v1
+bool edge_manifold(const chain_edge* e, const body* b, const shape* s, float32 margin, float32 t,
+                   manifold* m) {
+  vec2 center = get_center(b, t);
+  mat22 rot;
+  rot.set(b->r + t * b->w);
+  if (dot(e->normal, center + mul(rot, s->centroid) - e->v0) < float32(0)) {
+    return false;
+  }
+  int len = s->num_vertices;
+  vec2 polygon[MAX_VERTICES];
+  for (int i = 0; i < len; i++) {
+    polygon[i] = mul(rot, s->vertices[i]) + center;
+  }
+
+  float32 rounding = s->rounding;
+  vec2 edge[2] = {e->v0, e->v1};
+  vec2 closest_edge, closest_body;
+  float32 distance =
+      polygon_distance(edge, 2, polygon, len, &closest_edge, &closest_body, NULL, NULL);
+  if (distance - rounding > margin) {
+    return false;
+  }
+
+  // cores that touch or overlap are pushed out along the edge normal
+  vec2 normal = e->normal;
+  if (distance > tol) {
+    vec2 u = (float32(1) / distance) * (closest_body - closest_edge);
+    if (dot(u, normal) < float32(0.99f)) {
+      vec2 dir = e->v1 - e->v0;
+      bool owned;
+      if (dot(closest_edge - e->v0, dir) > float32(0.5f) * dot(dir, dir)) {
+        vec2 next = e->ghost1 - e->v1;
+        owned = openEnd(e->v1, e->ghost1) ||
+                (convexCorner(dir, next) && dot(u, next) <= float32(0));
+      } else {
+        owned = openEnd(e->v0, e->ghost0);
+      }
+      return owned && roundedPoint(closest_edge, closest_body, u, float32(0), rounding, margin, m);
+    }
+  }
+
+  // a circle over a shared vertex is owned like a corner, so the two edges of a joint never both
+  // push it
+  if (len == 1) {
+    vec2 dir = e->v1 - e->v0;
+    float32 along = dot(polygon[0] - e->v0, dir);
+    if ((along <= float32(0) && !openEnd(e->v0, e->ghost0)) ||
+        (along > dot(dir, dir) && !openEnd(e->v1, e->ghost1) &&
+         !convexCorner(dir, e->ghost1 - e->v1))) {
+      return false;
+    }
+    vec2 core = polygon[0] - dot(normal, polygon[0] - e->v0) * normal;
+    return roundedPoint(core, polygon[0], normal, float32(0), rounding, margin, m);
+  }
+
+  // the edge is always the reference face, keys only hold the ids of the incident points. the
+  // surface is on the left of the edge while polygon faces have it on the right, so it is passed
+  // from v1 to v0
+  float32 unused;
+  int face = bestFace(s, mul_transpose(rot, -normal), &unused);
+  vec2 segment[2] = {polygon[face], polygon[(face + 1) % len]};
+  int ids[2] = {face, (face + 1) % len};
+  if (!clipIncident(e->v1, e->v0, normal, 0, segment, ids, false, float32(0), rounding, margin,
+                    m)) {
+    if (distance > tol) {
+      return roundedPoint(closest_edge, closest_body, normal, float32(0), rounding, margin, m);
+    }
+    return false;
+  }
+  return m->point_count > 0;
+}
+
+// the edge is swept as a static segment. the first touch is only an impact if the edge has a
+// contact for the body there and the body moves into it by more than margin over the rest of the
+// step: a body sliding along the chain touches the next edge without moving into it, and touches
+// owned by a neighboring edge are found when that edge is swept
+bool edge_collision(const chain_edge* e, const body* b, const shape* s, float32 margin,
+                    float32* impact_time, vec2* impact, float32 start_time,
+                    rotation_sampling rotation) {
+  mat22 rot;
+  rot.set(b->r + start_time * b->w);
+  if (dot(e->normal, get_center(b, start_time) + mul(rot, s->centroid) - e->v0) < float32(0)) {
+    return false;
+  }
+  shape segment;
+  segment.num_vertices = 2;
+  segment.vertices[0] = e->v0;
+  segment.vertices[1] = e->v1;
+  segment.normals[0] = -e->normal;
+  segment.normals[1] = e->normal;
+  body ground;
+  feature fa, fb;
+  if (!continuous_collision(&ground, &segment, b, s, impact_time, &fa, &fb, impact, start_time,
+                            rotation)) {
+    return false;
+  }
+
+  body moved = *b;
+  moved.center = get_center(b, *impact_time);
+  moved.r = b->r + *impact_time * b->w;
+  manifold m;
+  if (!edge_manifold(e, &moved, s, margin, float32(0), &m)) {
+    return false;
+  }
+  float32 remaining = float32(1) - *impact_time;
+  for (int i = 0; i < m.point_count; i++) {
+    vec2 vel = b->vel + cross(b->w, m.points[i].point - moved.center);
+    if (remaining * dot(m.normal, vel) < -margin) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// GJK that stops as soon as a support point shows the origin is further than rounding from the
+// difference of the polygons, so separated pairs usually finish in an iteration or two
+bool polygons_overlap(const vec2* polygon_a, int len_a, const vec2* polygon_b, int len_b,
+                      float32 rounding) {
+  simplex_vertex simplex[3];
+  int simplex_size = 1;
+  vec2 origin{float32(0.0f), float32(0.0f)};
+  float32 divisor = float32(1.0f);
+  int previous_index_a[3];
+  int previous_index_b[3];
+  int previous_simplex_size = 1;
+
+  simplex[0].b_coord = float32(1.0f);
+  simplex[0].point_a = polygon_a[0];
+  simplex[0].index_a = 0;
+  simplex[0].point_b = polygon_b[0];
+  simplex[0].index_b = 0;
+  simplex[0].point = simplex[0].point_b - simplex[0].point_a;
+
+  for (int iter = 0; iter < 20; iter++) {
+    for (int i = 0; i < simplex_size; i++) {
+      previous_index_a[i] = simplex[i].index_a;
+      previous_index_b[i] = simplex[i].index_b;
+    }
+    previous_simplex_size = simplex_size;
+    if (simplex_size == 2) {
+      simplex_size = solveSimplex2(simplex, &divisor, origin);
+    } else if (simplex_size == 3) {
+      simplex_size = solveSimplex3(simplex, &divisor, origin);
+    }
+    if (simplex_size == 3) {
+      return true;
+    }
+
+    vec2 d = getSearchDirection(simplex, simplex_size);
+    if (dot(d, d) == 0) {
+      return true;  // the origin is a vertex of the difference, the polygons touch
+    }
+    simplex_vertex* v = simplex + simplex_size;
+    v->index_a = getSupportPoint(polygon_a, len_a, -d);
+    v->point_a = polygon_a[v->index_a];
+    v->index_b = getSupportPoint(polygon_b, len_b, d);
+    v->point_b = polygon_b[v->index_b];
+    v->point = v->point_b - v->point_a;
+
+    // the whole difference is behind the origin along d by more than the rounding
+    float32 reach = dot(v->point, d);
+    if (reach < float32(0) && reach * reach > rounding * rounding * dot(d, d)) {
+      return false;
+    }
+
+    bool duplicate = false;
+    for (int i = 0; i < previous_simplex_size; i++) {
+      if (v->index_a == previous_index_a[i] && v->index_b == previous_index_b[i]) {
+        duplicate = true;
+        break;
+      }
+    }
+    if (duplicate) {
+      break;
+    }
+    simplex_size++;
+  }
+
+  // converged closer than the rounding without containing the origin
+  vec2 a, b;
+  return getClosestPoints(simplex, simplex_size, divisor, &a, &b) <= rounding;
+}
+
+bool shapes_overlap(const body* body_a, const shape* shape_a, const body* body_b,
+                    const shape* shape_b) {
+  vec2 polygon_a[MAX_VERTICES];
+  vec2 polygon_b[MAX_VERTICES];
+  get_absolute_vertices(body_a, shape_a, polygon_a);
+  get_absolute_vertices(body_b, shape_b, polygon_b);
+  return polygons_overlap(polygon_a, shape_a->num_vertices, polygon_b, shape_b->num_vertices,
+                          shape_a->rounding + shape_b->rounding);
+}
+
 /*points a0,a1, b0,b1 find intersection of line segments defined by these points.
   va is vector a0->a1, vb is vector b0->b1
   system of equations parameterized s,t [0:1]
@@ -777,43 +1677,43 @@ bool line_segment_intersect(vec2 a0, vec2 a1, vec2 b0, vec2 b1, vec2* intersecti
   return true;
 }
 
-// get vertices translated to center with angle r
-// t is return parameter vec2* with length of at least num_vertices
-void get_absolute_vertices(const body* b, vec2* v) {
+// get vertices of shape s translated to center with angle r
+// v is return parameter vec2* with length of at least num_vertices
+void get_absolute_vertices(const body* b, const shape* s, vec2* v) {
   mat22 rot;  // rotation matrix
   rot.set(b->r);
-  for (int i = 0; i < b->num_vertices; i++) {
-    v[i] = mul(rot, b->vertices[i]);
+  for (int i = 0; i < s->num_vertices; i++) {
+    v[i] = mul(rot, s->vertices[i]);
     v[i] += b->center;
   }
 }
 
 // get absolute vertices when applying velocity timestep t
-void get_absolute_vertices(const body* b, vec2* v, float32 t) {
+void get_absolute_vertices(const body* b, const shape* s, vec2* v, float32 t) {
   mat22 rot;  // rotation matrix
   rot.set(b->r + (t * b->w));
-  for (int i = 0; i < b->num_vertices; i++) {
-    v[i] = mul(rot, b->vertices[i]);
+  for (int i = 0; i < s->num_vertices; i++) {
+    v[i] = mul(rot, s->vertices[i]);
     v[i] += b->center + (t * b->vel);
   }
 }
 
 // get absolute vertices when applying velocity timestep t
-vec2 get_absolute_vertex(const body* b, int index, float32 t) {
+vec2 get_absolute_vertex(const body* b, const shape* s, int index, float32 t) {
   vec2 v;
   mat22 rot;  // rotation matrix
   rot.set(b->r + (t * b->w));
-  v = mul(rot, b->vertices[index]);
+  v = mul(rot, s->vertices[index]);
   v += b->center + (t * b->vel);
   return v;
 }
 
 // get absolute vertices when applying velocity timestep t
-vec2 get_absolute_vertex(const body* b, int index) {
+vec2 get_absolute_vertex(const body* b, const shape* s, int index) {
   vec2 v;
   mat22 rot;  // rotation matrix
   rot.set(b->r + b->w);
-  v = mul(rot, b->vertices[index]);
+  v = mul(rot, s->vertices[index]);
   v += b->center + b->vel;
   return v;
 }
@@ -1,9 +1,11 @@
 #ifndef COLLISION_H
 #define COLLISION_H
 #include <assert.h>
+#include <stdint.h>
 #include "math_util.h"
+#include "shape.h"
 
-#define MAX_VERTICES 8
+#define MAX_MANIFOLD_POINTS 2
 
 // simplex vertex of Minkowski difference
 struct simplex_vertex {
@@ -23,39 +25,162 @@ struct feature {
   bool edge;
 };
 
+// contact point between two touching polygons
+struct manifold_point {
+  vec2 point;          // absolute position, halfway between the polygons
+  float32 separation;  // negative when penetrating
+  uint32_t key;        // identifies the features the point came from, stable between steps
+};
+
+// contacts with compound bodies keep the children they came from in the top byte of their keys,
+// the child of body A in bits 24 to 27 and the child of body B above it. other shapes are child 0
+static_assert(MAX_CHILDREN <= 16, "children must fit in 4 bits of a key");
+
+inline uint32_t child_key(int child_a, int child_b) {
+  return (uint32_t)child_a << 24 | (uint32_t)child_b << 28;
+}
+
+inline int key_child_a(uint32_t key) {
+  return (int)(key >> 24 & 15);
+}
+
+inline int key_child_b(uint32_t key) {
+  return (int)(key >> 28);
+}
+
+// up to two contact points sharing a normal pointing from polygon A to polygon B
+struct manifold {
+  vec2 normal;
+  manifold_point points[MAX_MANIFOLD_POINTS];
+  int point_count = 0;
+};
+
+// how a body is kept from tunneling. a pair uses the most thorough mode of its dynamic bodies
+enum ccd_mode {
+  CCD_OFF,          // contacts within the contact margin only
+  CCD_SPECULATIVE,  // contacts out to the distance the pair can close during the step
+  CCD_FULL,         // time of impact sweeps for pairs that don't touch
+};
+
+// a pair of bodies collides if each one's category shares a bit with the other's mask. bodies in
+// the same nonzero group always collide if the group is positive and never if it is negative,
+// whatever their categories
+struct collision_filter {
+  uint32_t category = 1;
+  uint32_t mask = 0xffffffff;
+  int group = 0;
+};
+
+// no branches, the broadphase runs this for every overlapping pair
+inline bool should_collide(const collision_filter& a, const collision_filter& b) {
+  uint32_t same = (uint32_t)(a.group == b.group) & (uint32_t)(a.group != 0);
+  uint32_t masks = (uint32_t)((a.category & b.mask) != 0) & (uint32_t)((b.category & a.mask) != 0);
+  return ((same & (uint32_t)(a.group > 0)) | ((same ^ 1u) & masks)) != 0;
+}
+
 struct body {
   body() {}
 
+  int id = -1;  // reported in collision diagnostics, add_body sets it to the body index if unset
   vec2 center = {float32(0), float32(0)};  // point
   vec2 vel = {float32(0), float32(0)};
   float32 w = float32(0);  // angular velocity
   float32 r = float32(0);  // angle
-  vec2 vertices[MAX_VERTICES];
-  int num_vertices = 0;
+  int shape_id = -1;       // shape in the world's registry
   float32 inv_mass = float32(0);
   float32 inv_I = float32(0);
   float32 friction = float32(0);
+  ccd_mode ccd = CCD_FULL;
+  collision_filter filter;
+  // reports overlap events with the bodies it meets instead of colliding with them. sensors
+  // don't sense each other or the terrain
+  bool sensor = false;
+};
+
+// unusual paths through the collision functions, counted instead of printed
+enum collision_diagnostic {
+  DIAG_DISCRETE_FALLBACK,        // already overlapping at the start of a sweep, separated with SAT
+  DIAG_DISCRETE_STILL_TOUCHING,  // SAT separation still left the polygons touching
+  DIAG_BISECTION_LIMIT,          // root finding ran out of iterations
+  DIAG_TOO_DEEP,                 // advancement stepped past the surface
+  DIAG_ADVANCEMENT_LIMIT,        // bilateral advancement ran out of iterations
+  DIAG_COUNT
+};
+
+typedef void (*diagnostic_callback)(collision_diagnostic reason, int id_a, int id_b, void* user);
+
+struct collision_diagnostics {
+  uint32_t counts[DIAG_COUNT] = {};
+  diagnostic_callback callback = nullptr;  // optional, called with the ids of both bodies
+  void* user = nullptr;
 };
 
-bool continuous_collision(const body* body_a, const body* body_b, float32* impact_time, feature* fa,
-                         feature* fb, vec2* impact, float32 start_time);
+// route diagnostics raised on the calling thread to sink (null to ignore them), returns the old sink
+collision_diagnostics* set_collision_diagnostics(collision_diagnostics* sink);
+
+// how the sweeps get the rotation of a body at times during the step
+enum rotation_sampling {
+  ROTATION_EXACT,       // sine and cosine of the angle at every sample
+  ROTATION_POLYNOMIAL,  // start rotation turned by polynomial sine and cosine of the angle swept
+};
+
+// the collision functions taking bodies read the pose and motion from the body and the polygon
+// from its shape
+bool continuous_collision(const body* body_a, const shape* shape_a, const body* body_b,
+                          const shape* shape_b, float32* impact_time, feature* fa, feature* fb,
+                          vec2* impact, float32 start_time, rotation_sampling rotation);
 // GJK
 float32 polygon_distance(const vec2* polygon_a, int len_a, const vec2* polygon_b, int len_b,
                       vec2* closest_a, vec2* closest_b, feature* feature_a, feature* feature_b);
+// true if the polygons come within rounding of each other, touching included. GJK that gives up
+// early on separated polygons and finds no closest points, features or time of impact
+bool polygons_overlap(const vec2* polygon_a, int len_a, const vec2* polygon_b, int len_b,
+                      float32 rounding);
+// polygons_overlap of the shapes of two bodies at the start of the step
+bool shapes_overlap(const body* body_a, const shape* shape_a, const body* body_b,
+                    const shape* shape_b);
 bool line_segment_intersect(vec2 a0, vec2 a1, vec2 b0, vec2 b1, vec2* intersection, float32* ta,
                           float32* tb);
 bool separating_axis_intersect(const vec2 a[], int a_len, const vec2 b[], int b_len,
                              vec2* minimum_vector, float32* minimum_overlap);
-void handle_collision(body* body_a, body* body_b, feature fa, feature fb, vec2 impact, float32 t,
-                     float32 restitution);
+void handle_collision(body* body_a, const shape* shape_a, body* body_b, const shape* shape_b,
+                      feature fa, feature fb, vec2 impact, float32 t, float32 restitution);
+// contact manifold by clipping the incident face against the reference face at time t
+// returns false if the polygons are further apart than margin
+bool polygon_manifold(const body* body_a, const shape* shape_a, const body* body_b,
+                      const shape* shape_b, float32 margin, float32 t, manifold* m);
+// edge of a static chain in absolute coordinates. the surface faces normal, on the left of the
+// edge from v0 to v1, and only collides with bodies in front of it. the ghosts are the chain's
+// vertices before v0 and after v1, or v0 and v1 themselves at the ends of an open chain, they tell
+// which corners are convex so bodies slide over the seams between edges
+struct chain_edge {
+  vec2 v0, v1;
+  vec2 ghost0, ghost1;
+  vec2 normal;
+};
+
+// contact manifold of a body against an edge at time t, the normal points from the edge to the
+// body. returns false if they are further apart than margin, if the shape's centroid is behind the
+// edge or if the body is closest to a vertex another edge of the chain has the contact for
+bool edge_manifold(const chain_edge* e, const body* b, const shape* s, float32 margin, float32 t,
+                   manifold* m);
+// continuous_collision of a body against an edge, only reports impacts edge_manifold has contacts
+// for with margin and that the body moves into by more than margin before the step ends
+bool edge_collision(const chain_edge* e, const body* b, const shape* s, float32 margin,
+                    float32* impact_time, vec2* impact, float32 start_time,
+                    rotation_sampling rotation);
+int getSupportPoint(const vec2* p, int len, vec2 d);
+// closest feature of a GJK simplex to target, returns the reduced simplex size
+int solveSimplex2(simplex_vertex* simplex, float32* divisor, vec2 target);
+int solveSimplex3(simplex_vertex* simplex, float32* divisor, vec2 target);
 
 
-// get vertices translated to center with angle r
-// t is return parameter vec2* with length of at least num_vertices
-void get_absolute_vertices(const body* b, vec2* v);
-void get_absolute_vertices(const body* b, vec2* v, float32 t);
-vec2 get_absolute_vertex(const body* b, int index, float32 t);
-vec2 get_absolute_vertex(const body* b, int index);
+// get vertices of shape s translated to center with angle r
+// v is return parameter vec2* with length of at least num_vertices
+void get_absolute_vertices(const body* b, const shape* s, vec2* v);
+void get_absolute_vertices(const body* b, const shape* s, vec2* v, float32 t);
+vec2 get_absolute_vertex(const body* b, const shape* s, int index, float32 t);
+vec2 get_absolute_vertex(const body* b, const shape* s, int index);
 vec2 get_center(const body* b, float32 t);
 
 #endif  // COLLISION_H
\ No newline at end of file
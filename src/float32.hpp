@@ -1,4 +1,5 @@
 #pragma once
+#include <string.h>
 extern "C" {
 #include <softfloat/include/softfloat.h>
 }
@@ -41,9 +42,9 @@ struct float32 {
 
   // cast back to regular float
   inline explicit operator float() const {
-    uint32_t temp = v.v;
-    float* result = reinterpret_cast<float*>(&temp);
-    return *result;
+    float result;
+    memcpy(&result, &v.v, sizeof(result));
+    return result;
   }
 
   // cast to softfloat type
@@ -91,6 +91,11 @@ inline vec2 mul(const mat22& A, const vec2& v) {
   return vec2(A.column1.x * v.x + A.column2.x * v.y, A.column1.y * v.x + A.column2.y * v.y);
 }
 
+// inverse rotation, A transposed times v
+inline vec2 mul_transpose(const mat22& A, const vec2& v) {
+  return vec2(A.column1.x * v.x + A.column1.y * v.y, A.column2.x * v.x + A.column2.y * v.y);
+}
+
 // float32 operations
 inline float32 max(float32 a, float32 b) {
   return a > b ? a : b;
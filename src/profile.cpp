@@ -0,0 +1,107 @@
+#include "profile.h"
+#include <string.h>
+
+#ifdef JUMPHYSICS_PROFILE
+#include <atomic>
+#include <mutex>
+
+#define PROFILE_VALUE_COUNT \
+  (PROF_COUNTER_COUNT + PROF_HISTOGRAM_COUNT * (PROFILE_HISTOGRAM_BUCKETS + 1))
+
+// one per thread, only the owning thread writes values. blocks are never freed so counts from
+// finished threads stay in the totals. resets move the baseline instead of clearing the values
+// so the owner never races with the thread taking the snapshot
+struct profileBlock {
+  std::atomic<uint64_t> values[PROFILE_VALUE_COUNT];
+  uint64_t baseline[PROFILE_VALUE_COUNT];  // guarded by registry_mutex
+  profileBlock* next;
+};
+
+static std::mutex registry_mutex;
+static profileBlock* registry = nullptr;
+static thread_local profileBlock* local_block = nullptr;
+
+static profileBlock* localBlock() {
+  if (!local_block) {
+    profileBlock* block = new profileBlock;
+    for (int i = 0; i < PROFILE_VALUE_COUNT; i++) {
+      block->values[i].store(0, std::memory_order_relaxed);
+      block->baseline[i] = 0;
+    }
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    block->next = registry;
+    registry = block;
+    local_block = block;
+  }
+  return local_block;
+}
+
+static void add(int index, uint64_t amount) {
+  std::atomic<uint64_t>* value = localBlock()->values + index;
+  value->store(value->load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static int bucket(uint32_t value) {
+  int b = 0;
+  while (value && b < PROFILE_HISTOGRAM_BUCKETS - 1) {
+    value >>= 1;
+    b++;
+  }
+  return b;
+}
+
+// values are laid out as counters, then bucket counts followed by the total for each histogram
+static int histogramIndex(profile_histogram histogram, int b) {
+  return PROF_COUNTER_COUNT + histogram * (PROFILE_HISTOGRAM_BUCKETS + 1) + b;
+}
+
+void profile_count(profile_counter counter) {
+  add(counter, 1);
+}
+
+void profile_record(profile_histogram histogram, uint32_t value) {
+  add(histogramIndex(histogram, bucket(value)), 1);
+  add(histogramIndex(histogram, PROFILE_HISTOGRAM_BUCKETS), value);
+}
+
+void get_profile_snapshot(profile_snapshot* snapshot, bool reset) {
+  uint64_t sum[PROFILE_VALUE_COUNT] = {};
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (profileBlock* block = registry; block; block = block->next) {
+      for (int i = 0; i < PROFILE_VALUE_COUNT; i++) {
+        uint64_t value = block->values[i].load(std::memory_order_relaxed);
+        sum[i] += value - block->baseline[i];
+        if (reset) {
+          block->baseline[i] = value;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < PROF_COUNTER_COUNT; i++) {
+    snapshot->counters[i] = sum[i];
+  }
+  for (int h = 0; h < PROF_HISTOGRAM_COUNT; h++) {
+    for (int b = 0; b < PROFILE_HISTOGRAM_BUCKETS; b++) {
+      snapshot->histograms[h][b] = sum[histogramIndex((profile_histogram)h, b)];
+    }
+    snapshot->totals[h] = sum[histogramIndex((profile_histogram)h, PROFILE_HISTOGRAM_BUCKETS)];
+  }
+}
+
+void reset_profile() {
+  profile_snapshot unused;
+  get_profile_snapshot(&unused, true);
+}
+
+#else
+
+void get_profile_snapshot(profile_snapshot* snapshot, bool reset) {
+  (void)reset;
+  memset(snapshot, 0, sizeof(*snapshot));
+}
+
+void reset_profile() {}
+
+#endif
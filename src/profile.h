@@ -0,0 +1,53 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <stdint.h>
+
+// work counters for the collision kernels. recording compiles to nothing unless
+// JUMPHYSICS_PROFILE is defined, the snapshot functions then just return zeros
+
+// bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i), the last bucket is open ended
+#define PROFILE_HISTOGRAM_BUCKETS 12
+
+enum profile_counter {
+  PROF_GJK_QUERIES,         // polygon_distance calls
+  PROF_SAT_QUERIES,         // separating_axis_intersect calls
+  PROF_CCD_QUERIES,         // continuous_collision calls
+  PROF_CCD_HITS,            // continuous_collision calls that found an impact
+  PROF_DISCRETE_FALLBACKS,  // continuous_collision calls that started overlapping
+  PROF_CCD_TRANSLATING,     // continuous_collision calls between bodies that don't rotate
+  PROF_GJK_ITERATION_LIMIT,
+  PROF_ADVANCEMENT_LIMIT,
+  PROF_BISECTION_LIMIT,
+  PROF_COUNTER_COUNT
+};
+
+// distributions of the work done by a single query
+enum profile_histogram {
+  PROF_GJK_ITERATIONS,    // per polygon_distance call
+  PROF_CCD_ADVANCEMENTS,  // bilateral advancement rounds per continuous_collision call
+  PROF_CCD_BISECTIONS,    // root finding steps per continuous_collision call
+  PROF_HISTOGRAM_COUNT
+};
+
+struct profile_snapshot {
+  uint64_t counters[PROF_COUNTER_COUNT];
+  uint64_t histograms[PROF_HISTOGRAM_COUNT][PROFILE_HISTOGRAM_BUCKETS];
+  uint64_t totals[PROF_HISTOGRAM_COUNT];  // sum of the recorded values
+};
+
+// sum of the counters of every thread since the last reset. with reset set the next snapshot
+// starts from zero again, which gives per frame numbers when called once per frame
+void get_profile_snapshot(profile_snapshot* snapshot, bool reset);
+void reset_profile();
+
+#ifdef JUMPHYSICS_PROFILE
+void profile_count(profile_counter counter);
+void profile_record(profile_histogram histogram, uint32_t value);
+#define PROFILE_COUNT(counter) profile_count(counter)
+#define PROFILE_RECORD(histogram, value) profile_record(histogram, value)
+#else
+#define PROFILE_COUNT(counter) ((void)0)
+#define PROFILE_RECORD(histogram, value) ((void)0)
+#endif
+
+#endif  // PROFILE_H
@@ -0,0 +1,275 @@
+#include "replay.h"
+#include <string.h>
+#include <algorithm>
+#include "snapshot.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define REPLAY_FRAME_SIZE 12  // frame, hash low and high words
+#define REPLAY_INPUT_SIZE 16  // body, impulse x and y, angular impulse
+
+static void writeRecord(FILE* file, replay_record_type type, const void* payload, uint32_t size) {
+  replay_record_header header;
+  header.type = type;
+  header.size = size;
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(payload, size, 1, file);
+}
+
+bool open_recording(replay_recorder* rec, const char* path, const world* w, int keyframe_interval) {
+  rec->file = fopen(path, "wb");
+  if (!rec->file) {
+    return false;
+  }
+  // the stdio buffer is allocated once here, records are only copied into it
+  setvbuf(rec->file, nullptr, _IOFBF, 1 << 16);
+  rec->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+  rec->frame = 0;
+
+  replay_file_header header;
+  header.magic = REPLAY_MAGIC;
+  header.version = REPLAY_VERSION;
+  header.keyframe_interval = rec->keyframe_interval;
+  header.body_count = (uint32_t)w->bodies.size();
+  fwrite(&header, sizeof(header), 1, rec->file);
+  return true;
+}
+
+void record_frame(replay_recorder* rec, const world* w, const body_input* inputs, int count) {
+  update_state_hash(&rec->hash, w);
+  uint32_t frame[3] = {(uint32_t)rec->frame, (uint32_t)rec->hash.value,
+                       (uint32_t)(rec->hash.value >> 32)};
+  writeRecord(rec->file, REPLAY_FRAME, frame, REPLAY_FRAME_SIZE);
+
+  if (rec->frame % rec->keyframe_interval == 0) {
+    rec->snapshot.resize(snapshot_size(w));
+    save_snapshot(w, rec->snapshot.data(), rec->snapshot.size());
+    writeRecord(rec->file, REPLAY_KEYFRAME, rec->snapshot.data(), (uint32_t)rec->snapshot.size());
+  }
+
+  for (int i = 0; i < count; i++) {
+    uint32_t input[4];
+    input[0] = (uint32_t)inputs[i].body;
+    input[1] = inputs[i].impulse.x.v.v;
+    input[2] = inputs[i].impulse.y.v.v;
+    input[3] = inputs[i].angular_impulse.v.v;
+    writeRecord(rec->file, REPLAY_INPUT, input, REPLAY_INPUT_SIZE);
+  }
+  rec->frame++;
+}
+
+void close_recording(replay_recorder* rec) {
+  if (rec->file) {
+    fclose(rec->file);
+    rec->file = nullptr;
+  }
+}
+
+static replay_record_header readHeader(const replay_player* p, size_t offset) {
+  replay_record_header header;
+  memcpy(&header, p->data + offset, sizeof(header));
+  return header;
+}
+
+static bool mapFile(replay_player* p, const char* path) {
+#ifdef _WIN32
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t* data = size > 0 ? new uint8_t[size] : nullptr;
+  bool ok = data && fread(data, size, 1, file) == 1;
+  fclose(file);
+  if (!ok) {
+    delete[] data;
+    return false;
+  }
+  p->data = data;
+  p->size = size;
+  return true;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  p->data = (const uint8_t*)data;
+  p->size = st.st_size;
+  return true;
+#endif
+}
+
+// index every complete frame, a frame cut short by the end of the file is dropped
+static void indexFrames(replay_player* p) {
+  p->frames.clear();
+  p->keyframes.clear();
+  size_t offset = sizeof(replay_file_header);
+  bool truncated = false;
+  while (offset < p->size) {
+    if (p->size - offset < sizeof(replay_record_header)) {
+      truncated = true;
+      break;
+    }
+    replay_record_header header = readHeader(p, offset);
+    if (p->size - offset - sizeof(header) < header.size) {
+      truncated = true;
+      break;
+    }
+    if (header.type == REPLAY_FRAME) {
+      p->frames.push_back(offset);
+    } else if (header.type == REPLAY_KEYFRAME && !p->frames.empty()) {
+      p->keyframes.push_back((int)p->frames.size() - 1);
+    }
+    offset += sizeof(header) + header.size;
+  }
+  p->end = offset;
+  if (truncated && !p->frames.empty()) {
+    p->end = p->frames.back();
+    p->frames.pop_back();
+    if (!p->keyframes.empty() && p->keyframes.back() == (int)p->frames.size()) {
+      p->keyframes.pop_back();
+    }
+  }
+}
+
+bool open_replay(replay_player* p, const char* path, world* w) {
+  if (!mapFile(p, path)) {
+    return false;
+  }
+  replay_file_header header;
+  if (p->size < sizeof(header)) {
+    close_replay(p);
+    return false;
+  }
+  memcpy(&header, p->data, sizeof(header));
+  if (header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION ||
+      header.body_count != w->bodies.size()) {
+    close_replay(p);
+    return false;
+  }
+  p->w = w;
+  p->keyframe_interval = header.keyframe_interval;
+  p->frame = 0;
+  p->first_mismatch = -1;
+  indexFrames(p);
+  return true;
+}
+
+int replay_frame_count(const replay_player* p) {
+  return (int)p->frames.size();
+}
+
+// end of the records of frame
+static size_t frameEnd(const replay_player* p, int frame) {
+  return frame + 1 < (int)p->frames.size() ? p->frames[frame + 1] : p->end;
+}
+
+static bool restoreKeyframe(replay_player* p, int frame) {
+  size_t end = frameEnd(p, frame);
+  for (size_t offset = p->frames[frame]; offset < end;) {
+    replay_record_header header = readHeader(p, offset);
+    offset += sizeof(header);
+    if (header.type == REPLAY_KEYFRAME) {
+      // the snapshot is restored straight from the mapped file
+      if (!restore_snapshot(p->w, p->data + offset, header.size)) {
+        return false;
+      }
+      p->frame = frame;
+      return true;
+    }
+    offset += header.size;
+  }
+  return false;
+}
+
+bool seek_replay(replay_player* p, int frame) {
+  if (frame < 0 || frame > replay_frame_count(p)) {
+    return false;
+  }
+  std::vector<int>::const_iterator it =
+      std::upper_bound(p->keyframes.begin(), p->keyframes.end(), frame);
+  if (it == p->keyframes.begin()) {
+    return false;
+  }
+  int keyframe = *(it - 1);
+  // playing on from the current frame is never slower than going back to the same keyframe
+  if (p->frame > frame || p->frame < keyframe) {
+    if (!restoreKeyframe(p, keyframe)) {
+      return false;
+    }
+  }
+  while (p->frame < frame) {
+    step_replay(p);
+  }
+  return true;
+}
+
+bool step_replay(replay_player* p) {
+  if (p->frame >= replay_frame_count(p)) {
+    return false;
+  }
+  size_t end = frameEnd(p, p->frame);
+  for (size_t offset = p->frames[p->frame]; offset < end;) {
+    replay_record_header header = readHeader(p, offset);
+    offset += sizeof(header);
+    const uint8_t* payload = p->data + offset;
+    offset += header.size;
+
+    if (header.type == REPLAY_FRAME && header.size == REPLAY_FRAME_SIZE) {
+      uint32_t words[3];
+      memcpy(words, payload, sizeof(words));
+      update_state_hash(&p->hash, p->w);
+      uint64_t recorded = (uint64_t)words[1] | (uint64_t)words[2] << 32;
+      if (recorded != p->hash.value && p->first_mismatch < 0) {
+        p->first_mismatch = p->frame;
+      }
+    } else if (header.type == REPLAY_INPUT && header.size == REPLAY_INPUT_SIZE) {
+      uint32_t words[4];
+      memcpy(words, payload, sizeof(words));
+      body_input input;
+      input.frame = p->frame;
+      input.body = (int)words[0];
+      if (input.body < 0 || input.body >= (int)p->w->bodies.size()) {
+        continue;
+      }
+      input.impulse.x.v.v = words[1];
+      input.impulse.y.v.v = words[2];
+      input.angular_impulse.v.v = words[3];
+      apply_input(p->w, input);
+    }
+  }
+  step_world(p->w);
+  p->frame++;
+  return true;
+}
+
+void close_replay(replay_player* p) {
+  if (p->data) {
+#ifdef _WIN32
+    delete[] p->data;
+#else
+    munmap((void*)p->data, p->size);
+#endif
+  }
+  p->data = nullptr;
+  p->size = 0;
+  p->end = 0;
+  p->frames.clear();
+  p->keyframes.clear();
+}
@@ -0,0 +1,82 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "state_hash.h"
+#include "world.h"
+
+// replay files are a stream of records so a recording that was cut short can still be played up
+// to its last complete frame. every frame starts with a frame record holding the hash of the state
+// at the start of the frame, followed by a keyframe snapshot every keyframe_interval frames and
+// the inputs of the frame. shapes aren't recorded, the player needs a world built with the same
+// bodies as the recorded one
+
+#define REPLAY_MAGIC 0x5250524a  // "JRPR"
+#define REPLAY_VERSION 1
+
+enum replay_record_type {
+  REPLAY_FRAME,     // frame number and 64 bit state hash
+  REPLAY_KEYFRAME,  // snapshot of the state at the start of the frame
+  REPLAY_INPUT,     // body, impulse and angular impulse
+};
+
+struct replay_file_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t keyframe_interval;
+  uint32_t body_count;
+};
+
+struct replay_record_header {
+  uint32_t type;
+  uint32_t size;  // payload bytes following the header
+};
+
+struct replay_recorder {
+  FILE* file = nullptr;
+  int keyframe_interval = 0;
+  int frame = 0;
+  state_hash hash;
+  std::vector<uint8_t> snapshot;  // reused keyframe buffer
+};
+
+// returns false if the file can't be created
+bool open_recording(replay_recorder* rec, const char* path, const world* w, int keyframe_interval);
+
+// record the start of a frame, call with the inputs of the frame before applying them and
+// stepping the world
+void record_frame(replay_recorder* rec, const world* w, const body_input* inputs, int count);
+
+void close_recording(replay_recorder* rec);
+
+struct replay_player {
+  world* w = nullptr;
+  const uint8_t* data = nullptr;  // whole file, mapped read only
+  size_t size = 0;
+  size_t end = 0;  // end of the last complete frame
+  int keyframe_interval = 0;
+  int frame = 0;             // frame the world is at
+  int first_mismatch = -1;   // first played frame whose state hash didn't match the recording
+  std::vector<size_t> frames;     // offset of each frame record
+  std::vector<int> keyframes;     // frames that have a keyframe, ascending
+  state_hash hash;
+};
+
+// maps the file and indexes its frames, w must have the recorded bodies. returns false if the
+// file can't be read or doesn't match w
+bool open_replay(replay_player* p, const char* path, world* w);
+
+// restore the nearest keyframe at or before frame and play forward to it, returns false if the
+// recording doesn't reach frame
+bool seek_replay(replay_player* p, int frame);
+
+// apply the inputs of the current frame and step, returns false at the end of the recording
+bool step_replay(replay_player* p);
+
+int replay_frame_count(const replay_player* p);
+
+void close_replay(replay_player* p);
+
+#endif  // REPLAY_H
@@ -0,0 +1,256 @@
+#include "rollback.h"
+#include <algorithm>
+#include <chrono>
+#include "snapshot.h"
+
+static rollback_frame* slot(rollback* r, int frame) {
+  return &r->frames[frame % (int)r->frames.size()];
+}
+
+static bool inputBefore(const body_input& a, const body_input& b) {
+  return a.frame < b.frame || (a.frame == b.frame && a.body < b.body);
+}
+
+static bool pairBefore(const body_pair& p, const body_pair& q) {
+  return p.index_a < q.index_a || (p.index_a == q.index_a && p.index_b < q.index_b);
+}
+
+static void saveFrame(rollback* r, int frame) {
+  rollback_frame* f = slot(r, frame);
+  f->frame = frame;
+  f->snapshot.resize(snapshot_size(r->w));
+  save_snapshot(r->w, f->snapshot.data(), f->snapshot.size());
+}
+
+static void applyInputs(rollback* r, int frame) {
+  body_input key = {};
+  key.frame = frame;
+  key.body = -1;
+  std::vector<body_input>::const_iterator it =
+      std::lower_bound(r->inputs.begin(), r->inputs.end(), key, inputBefore);
+  for (; it != r->inputs.end() && it->frame == frame; ++it) {
+    apply_input(r->w, *it);
+  }
+}
+
+void init_rollback(rollback* r, world* w, int depth) {
+  r->w = w;
+  r->frame = 0;
+  r->depth = depth;
+  r->frames.assign(depth + 1, rollback_frame());
+  r->inputs.clear();
+  r->dirty_frame = -1;
+  r->late.clear();
+  r->stats.assign(depth + 1, rollback_depth_stats());
+  r->heights_version = w->heights_version;
+  saveFrame(r, 0);
+}
+
+bool add_input(rollback* r, const body_input& input) {
+  if (input.body < 0 || input.body >= (int)r->w->bodies.size() || input.frame < 0 ||
+      input.frame < r->frame - r->depth) {
+    return false;
+  }
+  std::vector<body_input>::iterator it =
+      std::lower_bound(r->inputs.begin(), r->inputs.end(), input, inputBefore);
+  if (it != r->inputs.end() && it->frame == input.frame && it->body == input.body) {
+    *it = input;
+  } else {
+    r->inputs.insert(it, input);
+  }
+
+  if (input.frame < r->frame) {
+    r->late.push_back(input);
+    if (r->dirty_frame < 0 || input.frame < r->dirty_frame) {
+      r->dirty_frame = input.frame;
+    }
+  }
+  return true;
+}
+
+static bool isSimulated(const world* w, int index) {
+  return is_dynamic(&w->bodies[index]) && !w->frozen[index];
+}
+
+// a body that interacted with a simulated body in the recorded step has to be simulated too,
+// returns true if any body was woken
+static bool wakeRecorded(world* w, const std::vector<body_pair>& pairs) {
+  bool any = false;
+  bool woke = true;
+  while (woke) {
+    woke = false;
+    for (size_t i = 0; i < pairs.size(); i++) {
+      int a = pairs[i].index_a;
+      int b = pairs[i].index_b;
+      if (isSimulated(w, a) && w->frozen[b] && is_dynamic(&w->bodies[b])) {
+        w->frozen[b] = 0;
+        woke = true;
+      } else if (isSimulated(w, b) && w->frozen[a] && is_dynamic(&w->bodies[a])) {
+        w->frozen[a] = 0;
+        woke = true;
+      }
+    }
+    any = any || woke;
+  }
+  return any;
+}
+
+static int frozenCount(const world* w) {
+  int count = 0;
+  for (size_t i = 0; i < w->bodies.size(); i++) {
+    count += w->frozen[i] && is_dynamic(&w->bodies[i]);
+  }
+  return count;
+}
+
+// bodies still frozen after stepping frame skip to their recorded state at the next frame, along
+// with the recorded contacts and pairs that only involve them
+static void fastForwardFrozen(rollback* r, rollback_frame* f, const rollback_frame* next) {
+  world* w = r->w;
+  for (size_t i = 0; i < w->bodies.size(); i++) {
+    if (w->frozen[i] && is_dynamic(&w->bodies[i])) {
+      restore_body_state(w, next->snapshot.data(), (int)i);
+    }
+  }
+
+  // the stepped contacts and pairs all have a simulated body and the recorded ones kept here
+  // have none, so the merges never see the same pair twice
+  std::vector<contact_constraint>& merged_contacts = w->previous_contacts;
+  merged_contacts.clear();
+  size_t k = 0;
+  int recorded = snapshot_contact_count(next->snapshot.data());
+  for (int i = 0; i < recorded; i++) {
+    contact_constraint c;
+    read_snapshot_contact(next->snapshot.data(), i, &c);
+    if (isSimulated(w, c.index_a) || isSimulated(w, c.index_b)) {
+      continue;
+    }
+    while (k < w->contacts.size() &&
+           (w->contacts[k].index_a < c.index_a ||
+            (w->contacts[k].index_a == c.index_a && w->contacts[k].index_b < c.index_b))) {
+      merged_contacts.push_back(w->contacts[k++]);
+    }
+    merged_contacts.push_back(c);
+  }
+  merged_contacts.insert(merged_contacts.end(), w->contacts.begin() + k, w->contacts.end());
+  w->contacts.swap(merged_contacts);
+
+  r->merged.clear();
+  for (size_t i = 0; i < f->pairs.size(); i++) {
+    if (!isSimulated(w, f->pairs[i].index_a) && !isSimulated(w, f->pairs[i].index_b)) {
+      r->merged.push_back(f->pairs[i]);
+    }
+  }
+  size_t kept = r->merged.size();
+  r->merged.insert(r->merged.end(), w->pairs.begin(), w->pairs.end());
+  std::inplace_merge(r->merged.begin(), r->merged.begin() + kept, r->merged.end(), pairBefore);
+  f->pairs.swap(r->merged);
+}
+
+// step frame with as few bodies as possible. the partial step matches a full one as long as no
+// frozen body is linked to a simulated one through the recorded or the new pairs, and the time of
+// impact events of both together stay below the limit, otherwise the frame is repeated with more
+// bodies awake
+static void resimulateFrame(rollback* r, int frame) {
+  world* w = r->w;
+  rollback_frame* f = slot(r, frame);
+  rollback_frame* next = slot(r, frame + 1);
+  int max_events = w->params.max_toi_events;
+
+  for (size_t i = 0; i < r->late.size(); i++) {
+    if (r->late[i].frame == frame) {
+      w->frozen[r->late[i].body] = 0;
+    }
+  }
+  if (f->toi_events >= max_events) {
+    std::fill(w->frozen.begin(), w->frozen.end(), 0);
+  }
+  wakeRecorded(w, f->pairs);
+
+  r->retry.resize(snapshot_size(w));
+  save_snapshot(w, r->retry.data(), r->retry.size());
+  for (;;) {
+    applyInputs(r, frame);
+    step_world(w);
+    bool partial = frozenCount(w) > 0;
+    if (partial && w->toi_events + f->toi_events >= max_events) {
+      std::fill(w->frozen.begin(), w->frozen.end(), 0);
+    } else if (!partial || !wakeRecorded(w, f->pairs)) {
+      break;
+    }
+    restore_snapshot(w, r->retry.data(), r->retry.size());
+  }
+
+  bool partial = frozenCount(w) > 0;
+  if (partial) {
+    fastForwardFrozen(r, f, next);
+    f->toi_events += w->toi_events;
+  } else {
+    f->pairs = w->pairs;
+    f->toi_events = w->toi_events;
+  }
+  // edits of the heights between frames aren't inputs, the recorded next frame has them
+  restore_heights(w, next->snapshot.data());
+  saveFrame(r, frame + 1);
+}
+
+static void resimulate(rollback* r) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  world* w = r->w;
+  int depth = r->frame - r->dirty_frame;
+  const rollback_frame* first = slot(r, r->dirty_frame);
+  restore_snapshot(w, first->snapshot.data(), first->snapshot.size());
+
+  w->frozen.resize(w->bodies.size());
+  int dynamic_count = 0;
+  for (size_t i = 0; i < w->bodies.size(); i++) {
+    w->frozen[i] = is_dynamic(&w->bodies[i]);
+    dynamic_count += w->frozen[i];
+  }
+
+  rollback_depth_stats* s = &r->stats[depth];
+  for (int frame = r->dirty_frame; frame < r->frame; frame++) {
+    resimulateFrame(r, frame);
+    s->woken_frames += dynamic_count - frozenCount(w);
+  }
+  w->frozen.clear();
+
+  s->rollbacks++;
+  s->frames += depth;
+  s->body_frames += (uint64_t)dynamic_count * depth;
+  s->ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+               .count();
+  r->dirty_frame = -1;
+  r->late.clear();
+  r->heights_version = w->heights_version;
+}
+
+void advance_frame(rollback* r) {
+  world* w = r->w;
+  if (w->heights_version != r->heights_version) {
+    save_heights(w, slot(r, r->frame)->snapshot.data());
+    r->heights_version = w->heights_version;
+  }
+  if (r->dirty_frame >= 0) {
+    resimulate(r);
+  }
+
+  rollback_frame* f = slot(r, r->frame);
+  applyInputs(r, r->frame);
+  step_world(w);
+  f->pairs = w->pairs;
+  f->toi_events = w->toi_events;
+
+  r->frame++;
+  saveFrame(r, r->frame);
+  rollback_frame* next = slot(r, r->frame);
+  next->pairs.clear();
+  next->toi_events = 0;
+
+  // inputs that can no longer be rolled back to
+  body_input oldest = {};
+  oldest.frame = r->frame - r->depth;
+  oldest.body = -1;
+  r->inputs.erase(r->inputs.begin(), std::lower_bound(r->inputs.begin(), r->inputs.end(),
+                                                      oldest, inputBefore));
+}
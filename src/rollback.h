@@ -0,0 +1,57 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+#include <stdint.h>
+#include <vector>
+#include "world.h"
+
+// keeps the last frames of a world as snapshots so inputs that arrive late can be inserted into
+// the past. the world is resimulated from the earliest frame with a late input, bodies that can't
+// have been affected by it follow their recorded states instead of being stepped
+
+// cost of the rollbacks that went back depth frames
+struct rollback_depth_stats {
+  int rollbacks = 0;
+  int frames = 0;              // frames resimulated
+  uint64_t body_frames = 0;    // dynamic bodies times frames resimulated
+  uint64_t woken_frames = 0;   // of those, the ones that had to be stepped
+  double ms = 0;
+};
+
+// state of the world at the start of a frame and what happened during it
+struct rollback_frame {
+  int frame = -1;
+  std::vector<uint8_t> snapshot;  // before the frame's inputs are applied
+  std::vector<body_pair> pairs;   // broadphase pairs of the frame, empty until it is stepped
+  int toi_events = 0;             // events of the step, an upper bound after a partial resimulation
+};
+
+struct rollback {
+  world* w = nullptr;
+  int frame = 0;  // frame the world is at, the next advance_frame steps it
+  int depth = 0;  // how many frames back inputs may be inserted
+
+  std::vector<rollback_frame> frames;  // ring buffer of depth + 1 frames
+  std::vector<body_input> inputs;      // sorted by frame and body
+  int dirty_frame = -1;                // earliest frame with a late input, -1 if none
+  std::vector<body_input> late;        // frame and body of the late inputs, impulses unused
+  std::vector<uint8_t> retry;          // state at the start of the frame being resimulated
+  std::vector<body_pair> merged;
+  uint32_t heights_version = 0;  // of the world, when its heights were last put in the history
+
+  std::vector<rollback_depth_stats> stats;  // indexed by rollback depth
+};
+
+// start recording w at frame 0 keeping depth frames of history
+void init_rollback(rollback* r, world* w, int depth);
+
+// a second input for the same frame and body replaces the first. inputs for frames that are
+// already simulated trigger a resimulation on the next advance_frame. returns false if the
+// frame is further back than the history or the body doesn't exist
+bool add_input(rollback* r, const body_input& input);
+
+// resimulate if needed, then apply the inputs of the current frame and step the world. heights
+// edited since the last call are part of the state the current frame starts from, resimulated
+// frames keep the heights they had
+void advance_frame(rollback* r);
+
+#endif  // ROLLBACK_H
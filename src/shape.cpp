@@ -0,0 +1,468 @@
+#include "shape.h"
+#include <assert.h>
+#include <algorithm>
+
+static uint64_t hashVertices(const vec2* vertices, int count, float32 rounding) {
+  uint64_t h = 14695981039346656037ull;
+  for (int i = 0; i <= count; i++) {
+    uint32_t words[2] = {rounding.v.v, 0};
+    if (i < count) {
+      words[0] = vertices[i].x.v.v;
+      words[1] = vertices[i].y.v.v;
+    }
+    for (int k = 0; k < 2; k++) {
+      h ^= words[k];
+      h *= 1099511628211ull;
+    }
+  }
+  return h;
+}
+
+static bool sameVertices(const shape* s, const vec2* vertices, int count, float32 rounding) {
+  if (s->num_vertices != count || s->rounding.v.v != rounding.v.v) {
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    if (s->vertices[i].x.v.v != vertices[i].x.v.v || s->vertices[i].y.v.v != vertices[i].y.v.v) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// area and polar moment about the origin of a circle
+static void circleMass(shape* s) {
+  float32 r = s->rounding;
+  vec2 c = s->vertices[0];
+  s->area = F32_M_PI * r * r;
+  s->inertia = s->area * (r * r / float32(2) + dot(c, c));
+  s->centroid = c;
+}
+
+// rectangle around the segment plus two half circles
+static void capsuleMass(shape* s) {
+  float32 r = s->rounding;
+  vec2 p1 = s->vertices[0];
+  vec2 p2 = s->vertices[1];
+  float32 length = sqrt(dot(p2 - p1, p2 - p1));
+  vec2 c = float32(0.5f) * (p1 + p2);
+  float32 box_area = float32(2) * r * length;
+  float32 circle_area = F32_M_PI * r * r;
+  // each half circle's centroid is 4r / 3pi past its end of the segment
+  float32 h = float32(0.5f) * length;
+  float32 lc = float32(4) * r / (float32(3) * F32_M_PI);
+  float32 box_inertia = box_area * (float32(4) * r * r + length * length) / float32(12);
+  float32 circle_inertia =
+      circle_area * (float32(0.5f) * r * r + h * h + float32(2) * h * lc);
+  s->area = box_area + circle_area;
+  s->inertia = box_inertia + circle_inertia + s->area * dot(c, c);
+  s->centroid = c;
+}
+
+// area and polar moment of the triangle fan around the origin. a rounded polygon adds a rectangle
+// of width rounding outside each edge and a circular sector at each corner, which together sweep
+// the full circle
+static void polygonMass(shape* s) {
+  int n = s->num_vertices;
+  vec2 moment(float32(0), float32(0));
+  for (int i = 0; i < n; i++) {
+    vec2 p1 = s->vertices[i];
+    vec2 p2 = s->vertices[(i + 1) % n];
+    float32 c = cross(p1, p2);
+    s->area += c / float32(2);
+    s->inertia += c * (dot(p1, p1) + dot(p1, p2) + dot(p2, p2)) / float32(12);
+    moment += (c / float32(6)) * (p1 + p2);
+  }
+  float32 r = s->rounding;
+  if (r > float32(0)) {
+    for (int i = 0; i < n; i++) {
+      vec2 p1 = s->vertices[i];
+      vec2 p2 = s->vertices[(i + 1) % n];
+      vec2 n1 = s->normals[(i + n - 1) % n];
+      vec2 n2 = s->normals[i];
+      float32 length = sqrt(dot(p2 - p1, p2 - p1));
+      float32 strip_area = length * r;
+      vec2 strip_center = float32(0.5f) * (p1 + p2) + (float32(0.5f) * r) * n2;
+      s->area += strip_area;
+      s->inertia += strip_area * ((length * length + r * r) / float32(12) +
+                                  dot(strip_center, strip_center));
+      moment += strip_area * strip_center;
+      // the sector at p1 spans the angle between the normals of its two edges, its first moment
+      // about p1 is r^3 / 3 times the chord between the normals turned clockwise
+      float32 angle = f32_atan2(cross(n1, n2), dot(n1, n2));
+      float32 sector_area = float32(0.5f) * angle * r * r;
+      vec2 sector_moment = (r * r * r / float32(3)) * cross(n2 - n1, float32(1));
+      s->area += sector_area;
+      s->inertia += sector_area * (float32(0.5f) * r * r + dot(p1, p1)) +
+                    float32(2) * dot(p1, sector_moment);
+      moment += sector_area * p1 + sector_moment;
+    }
+  }
+  s->centroid = (float32(1) / s->area) * moment;
+}
+
+static bool equal(vec2 a, vec2 b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+// normals, bounding radius and mass properties. a capsule's two edges are its segment in both
+// directions, a circle has none
+static void computeShapeData(shape* s) {
+  float32 radius_sq = float32(0);
+  int n = s->num_vertices;
+  for (int i = 0; i < n; i++) {
+    vec2 p1 = s->vertices[i];
+    radius_sq = max(radius_sq, dot(p1, p1));
+    if (n > 1) {
+      s->normals[i] = normalize(cross(s->vertices[(i + 1) % n] - p1, float32(1)));
+    }
+  }
+  s->radius = sqrt(radius_sq) + s->rounding;
+  if (n == 4 && s->rounding == float32(0)) {
+    vec2 h = s->vertices[2];
+    s->box = equal(s->vertices[0], -h) && equal(s->vertices[1], vec2(h.x, -h.y)) &&
+             equal(s->vertices[3], vec2(-h.x, h.y));
+    s->half_extents = s->box ? h : vec2(float32(0), float32(0));
+  }
+  if (n == 1) {
+    circleMass(s);
+  } else if (n == 2) {
+    capsuleMass(s);
+  } else {
+    polygonMass(s);
+  }
+}
+
+shape_error validate_polygon(const vec2* vertices, int count) {
+  if (count < 3 || count > MAX_VERTICES) {
+    return SHAPE_BAD_COUNT;
+  }
+  for (int i = 0; i < count; i++) {
+    vec2 edge = vertices[(i + 1) % count] - vertices[i];
+    if (edge.x == float32(0) && edge.y == float32(0)) {
+      return SHAPE_DEGENERATE;
+    }
+    // every other vertex strictly left of every edge, which also rules out polygons that wind
+    // around more than once
+    for (int j = 0; j < count; j++) {
+      if (j != i && j != (i + 1) % count &&
+          cross(edge, vertices[j] - vertices[i]) <= float32(0)) {
+        return SHAPE_NOT_CONVEX;
+      }
+    }
+  }
+  return SHAPE_OK;
+}
+
+// float32 comparisons with nan are true for >, so rounding is checked with <=
+static bool positive(float32 x) {
+  return x == x && !(x <= float32(0));
+}
+
+static int registerShape(shape_registry* registry, const vec2* vertices, int count,
+                         float32 rounding) {
+  uint64_t h = hashVertices(vertices, count, rounding);
+  typedef std::unordered_multimap<uint64_t, int>::const_iterator iterator;
+  std::pair<iterator, iterator> range = registry->lookup.equal_range(h);
+  for (iterator it = range.first; it != range.second; ++it) {
+    if (sameVertices(&registry->shapes[it->second], vertices, count, rounding)) {
+      return it->second;
+    }
+  }
+
+  shape s;
+  s.num_vertices = count;
+  s.rounding = rounding;
+  for (int i = 0; i < count; i++) {
+    s.vertices[i] = vertices[i];
+  }
+  computeShapeData(&s);
+  int id = (int)registry->shapes.size();
+  registry->shapes.push_back(s);
+  registry->lookup.insert(std::make_pair(h, id));
+  return id;
+}
+
+int add_shape(shape_registry* registry, const vec2* vertices, int count) {
+  return add_rounded_shape(registry, vertices, count, float32(0));
+}
+
+int add_rounded_shape(shape_registry* registry, const vec2* vertices, int count,
+                      float32 rounding) {
+  if (validate_polygon(vertices, count) != SHAPE_OK ||
+      !(positive(rounding) || rounding == float32(0))) {
+    return -1;
+  }
+  return registerShape(registry, vertices, count, rounding);
+}
+
+int add_box(shape_registry* registry, float32 half_width, float32 half_height) {
+  if (!positive(half_width) || !positive(half_height)) {
+    return -1;
+  }
+  vec2 vertices[4] = {vec2(-half_width, -half_height), vec2(half_width, -half_height),
+                      vec2(half_width, half_height), vec2(-half_width, half_height)};
+  return registerShape(registry, vertices, 4, float32(0));
+}
+
+int add_circle(shape_registry* registry, vec2 center, float32 radius) {
+  if (!positive(radius)) {
+    return -1;
+  }
+  return registerShape(registry, &center, 1, radius);
+}
+
+int add_capsule(shape_registry* registry, vec2 p1, vec2 p2, float32 radius) {
+  if (!positive(radius) || (p1.x == p2.x && p1.y == p2.y)) {
+    return -1;
+  }
+  vec2 vertices[2] = {p1, p2};
+  return registerShape(registry, vertices, 2, radius);
+}
+
+static bool pointBefore(vec2 a, vec2 b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+// twice the area of the triangle a b c, positive when it turns counterclockwise
+static float32 turn(vec2 a, vec2 b, vec2 c) {
+  return cross(b - a, c - a);
+}
+
+// Andrew's monotone chain, counterclockwise starting at the lowest point along x. collinear
+// points are left out
+static void convexHull(std::vector<vec2>* points, std::vector<vec2>* hull) {
+  std::sort(points->begin(), points->end(), pointBefore);
+  int n = (int)points->size();
+  hull->assign(2 * n, vec2(float32(0), float32(0)));
+  int k = 0;
+  for (int i = 0; i < n; i++) {
+    while (k >= 2 && turn((*hull)[k - 2], (*hull)[k - 1], (*points)[i]) <= float32(0)) {
+      k--;
+    }
+    (*hull)[k++] = (*points)[i];
+  }
+  for (int i = n - 2, lower = k + 1; i >= 0; i--) {
+    while (k >= lower && turn((*hull)[k - 2], (*hull)[k - 1], (*points)[i]) <= float32(0)) {
+      k--;
+    }
+    (*hull)[k++] = (*points)[i];
+  }
+  // the last point repeats the first
+  hull->resize(k > 1 ? k - 1 : k);
+}
+
+// drop the vertex whose triangle with its neighbors is the smallest, ties go to the lowest index
+static void removeSmallestCorner(std::vector<vec2>* hull) {
+  int n = (int)hull->size();
+  int smallest = 0;
+  float32 smallest_area = F32_MAX;
+  for (int i = 0; i < n; i++) {
+    float32 area = turn((*hull)[(i + n - 1) % n], (*hull)[i], (*hull)[(i + 1) % n]);
+    if (area < smallest_area) {
+      smallest_area = area;
+      smallest = i;
+    }
+  }
+  hull->erase(hull->begin() + smallest);
+}
+
+// vertices closer than tolerance to the line through their neighbors, repeated until none is
+static void removeFlatCorners(std::vector<vec2>* hull, float32 tolerance) {
+  bool removed = true;
+  while (removed && hull->size() > 3) {
+    removed = false;
+    int n = (int)hull->size();
+    for (int i = 0; i < n; i++) {
+      vec2 previous = (*hull)[(i + n - 1) % n];
+      vec2 base = (*hull)[(i + 1) % n] - previous;
+      float32 area = turn(previous, (*hull)[i], (*hull)[(i + 1) % n]);
+      // distance to the line is area / |base|, compared squared to avoid the square root
+      if (area * area <= tolerance * tolerance * dot(base, base)) {
+        hull->erase(hull->begin() + i);
+        removed = true;
+        break;
+      }
+    }
+  }
+}
+
+// area weighted centroid of the triangle fan around the first vertex
+static vec2 polygonCentroid(const std::vector<vec2>& hull) {
+  vec2 origin = hull[0];
+  vec2 sum(float32(0), float32(0));
+  float32 area = float32(0);
+  for (size_t i = 1; i + 1 < hull.size(); i++) {
+    vec2 e1 = hull[i] - origin;
+    vec2 e2 = hull[i + 1] - origin;
+    float32 a = cross(e1, e2) / float32(2);
+    sum += (a / float32(3)) * (e1 + e2);
+    area += a;
+  }
+  return origin + (float32(1) / area) * sum;
+}
+
+shape_error make_shape(shape_registry* registry, const vec2* points, int count,
+                       float32 weld_distance, int* id, vec2* centroid) {
+  if (count < 3) {
+    return SHAPE_BAD_COUNT;
+  }
+  std::vector<vec2> welded;
+  float32 weld_sq = weld_distance * weld_distance;
+  for (int i = 0; i < count; i++) {
+    bool duplicate = false;
+    for (size_t j = 0; j < welded.size() && !duplicate; j++) {
+      vec2 d = points[i] - welded[j];
+      duplicate = dot(d, d) <= weld_sq;
+    }
+    if (!duplicate) {
+      welded.push_back(points[i]);
+    }
+  }
+
+  std::vector<vec2> hull;
+  convexHull(&welded, &hull);
+  if (hull.size() < 3) {
+    return SHAPE_DEGENERATE;
+  }
+  removeFlatCorners(&hull, weld_distance);
+  while (hull.size() > MAX_VERTICES) {
+    removeSmallestCorner(&hull);
+  }
+
+  vec2 c = polygonCentroid(hull);
+  for (size_t i = 0; i < hull.size(); i++) {
+    hull[i] -= c;
+  }
+  shape_error error = validate_polygon(hull.data(), (int)hull.size());
+  if (error != SHAPE_OK) {
+    return error;
+  }
+  *id = add_shape(registry, hull.data(), (int)hull.size());
+  if (centroid) {
+    *centroid = c;
+  }
+  return SHAPE_OK;
+}
+
+// bounds of a child's surface in body coordinates
+static void childBounds(const shape* s, vec2* lower, vec2* upper) {
+  *lower = s->vertices[0];
+  *upper = s->vertices[0];
+  for (int i = 1; i < s->num_vertices; i++) {
+    vec2 v = s->vertices[i];
+    *lower = vec2(min(lower->x, v.x), min(lower->y, v.y));
+    *upper = vec2(max(upper->x, v.x), max(upper->y, v.y));
+  }
+  vec2 r(s->rounding, s->rounding);
+  *lower -= r;
+  *upper += r;
+}
+
+// median split of the children in order[first, first + count) along the longer side of the
+// bounds of their centers, ties go to the lower child index
+static void buildCompoundNode(compound* c, const vec2* lower, const vec2* upper, int* order,
+                              int index, int first, int count, int* node_count) {
+  compound_node* node = &c->nodes[index];
+  node->lower = lower[order[first]];
+  node->upper = upper[order[first]];
+  vec2 center_lower = c->centers[order[first]];
+  vec2 center_upper = center_lower;
+  for (int i = first; i < first + count; i++) {
+    int k = order[i];
+    node->lower = vec2(min(node->lower.x, lower[k].x), min(node->lower.y, lower[k].y));
+    node->upper = vec2(max(node->upper.x, upper[k].x), max(node->upper.y, upper[k].y));
+    vec2 center = c->centers[k];
+    center_lower = vec2(min(center_lower.x, center.x), min(center_lower.y, center.y));
+    center_upper = vec2(max(center_upper.x, center.x), max(center_upper.y, center.y));
+  }
+  if (count == 1) {
+    node->first = order[first];
+    node->count = 1;
+    return;
+  }
+
+  int axis = center_upper.y - center_lower.y > center_upper.x - center_lower.x ? 1 : 0;
+  const vec2* centers = c->centers;
+  std::sort(order + first, order + first + count, [centers, axis](int p, int q) {
+    float32 cp = axis ? centers[p].y : centers[p].x;
+    float32 cq = axis ? centers[q].y : centers[q].x;
+    return cp < cq || (cp == cq && p < q);
+  });
+  int left = *node_count;
+  *node_count += 2;
+  node->first = left;
+  node->count = 0;
+  buildCompoundNode(c, lower, upper, order, left, first, count / 2, node_count);
+  buildCompoundNode(c, lower, upper, order, left + 1, first + count / 2, count - count / 2,
+                    node_count);
+}
+
+shape_error make_compound(shape_registry* registry, const int* shape_ids, const vec2* offsets,
+                          int count, int* id, vec2* centroid) {
+  if (count < 1 || count > MAX_CHILDREN) {
+    return SHAPE_BAD_COUNT;
+  }
+  float32 area = float32(0);
+  vec2 moment(float32(0), float32(0));
+  for (int i = 0; i < count; i++) {
+    if (shape_ids[i] < 0 || shape_ids[i] >= (int)registry->shapes.size() ||
+        registry->shapes[shape_ids[i]].compound >= 0) {
+      return SHAPE_BAD_CHILD;
+    }
+    const shape* s = &registry->shapes[shape_ids[i]];
+    area += s->area;
+    moment += s->area * (s->centroid + offsets[i]);
+  }
+  vec2 c = (float32(1) / area) * moment;
+
+  // copies, registering the moved children can reallocate the registry
+  shape children[MAX_CHILDREN];
+  for (int i = 0; i < count; i++) {
+    children[i] = registry->shapes[shape_ids[i]];
+    for (int k = 0; k < children[i].num_vertices; k++) {
+      children[i].vertices[k] += offsets[i] - c;
+    }
+    // moving a polygon can round its vertices onto a line
+    if (children[i].num_vertices >= 3) {
+      shape_error error = validate_polygon(children[i].vertices, children[i].num_vertices);
+      if (error != SHAPE_OK) {
+        return error;
+      }
+    }
+  }
+
+  compound cp;
+  cp.child_count = count;
+  shape whole;
+  vec2 lower[MAX_CHILDREN];
+  vec2 upper[MAX_CHILDREN];
+  int order[MAX_CHILDREN];
+  for (int i = 0; i < count; i++) {
+    const shape* s = &children[i];
+    cp.children[i] = registerShape(registry, s->vertices, s->num_vertices, s->rounding);
+    const shape* child = &registry->shapes[cp.children[i]];
+    childBounds(child, lower + i, upper + i);
+    cp.centers[i] = float32(0.5f) * (lower[i] + upper[i]);
+    cp.radii[i] = float32(0);
+    for (int k = 0; k < child->num_vertices; k++) {
+      cp.radii[i] = max(cp.radii[i], distance(child->vertices[k], cp.centers[i]));
+    }
+    cp.radii[i] += child->rounding;
+    order[i] = i;
+    whole.radius = max(whole.radius, child->radius);
+    whole.area += child->area;
+    whole.inertia += child->inertia;
+  }
+  int node_count = 1;
+  buildCompoundNode(&cp, lower, upper, order, 0, 0, count, &node_count);
+
+  whole.compound = (int)registry->compounds.size();
+  registry->compounds.push_back(cp);
+  *id = (int)registry->shapes.size();
+  registry->shapes.push_back(whole);
+  if (centroid) {
+    *centroid = c;
+  }
+  return SHAPE_OK;
+}
@@ -0,0 +1,132 @@
+#ifndef SHAPE_H
+#define SHAPE_H
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "math_util.h"
+
+#define MAX_VERTICES 8
+#define MAX_CHILDREN 16  // shapes in a compound
+
+// convex core polygon in body coordinates, grown by rounding in every direction. one vertex with
+// rounding is a circle, two a capsule. registered once and shared by every body using it, shapes
+// never change after registration so the derived data below stays valid
+struct shape {
+  vec2 vertices[MAX_VERTICES];  // counterclockwise
+  vec2 normals[MAX_VERTICES];   // outward unit normal of the edge from vertex i to i + 1
+  int num_vertices = 0;
+  float32 rounding = float32(0);  // distance the surface keeps from the core polygon
+  float32 radius = float32(0);    // distance of the furthest surface point from the body origin
+  float32 area = float32(0);
+  float32 inertia = float32(0);  // polar moment about the body origin at unit density
+  vec2 centroid = {float32(0), float32(0)};  // in body coordinates
+  // rectangle centered on the body origin with its vertices in add_box order, pairs of boxes
+  // collide through a dedicated kernel
+  bool box = false;
+  vec2 half_extents = {float32(0), float32(0)};  // only set for boxes
+  // index into the registry's compounds for a compound shape, which has no vertices of its own
+  int compound = -1;
+};
+
+// bounds of a compound's children in body coordinates, laid out like the terrain hierarchy with
+// a single child in every leaf
+struct compound_node {
+  vec2 lower, upper;
+  int first;  // child of a leaf, left child of an inner node with the right child after it
+  int count;  // 1 for leaves, 0 for inner nodes
+};
+
+// convex shapes moving as one rigid body. the children are registered shapes with their vertices
+// already in the body's coordinates, so every collision function takes them with the compound's
+// body. the compound's own shape only carries the bounding radius and the summed mass properties
+struct compound {
+  int children[MAX_CHILDREN];    // shape ids, in the order they were given
+  vec2 centers[MAX_CHILDREN];    // center of each child's bounds
+  float32 radii[MAX_CHILDREN];   // distance of the child's furthest surface point from its center
+  int child_count = 0;
+  compound_node nodes[2 * MAX_CHILDREN - 1];  // root first
+};
+
+// why a polygon or point cloud can't be used as a shape
+enum shape_error {
+  SHAPE_OK,
+  SHAPE_BAD_COUNT,   // fewer than 3 vertices or more than MAX_VERTICES, or bad rounding
+  SHAPE_DEGENERATE,  // repeated vertices, or no area once near duplicates are welded
+  SHAPE_NOT_CONVEX,  // a corner turns clockwise or is collinear, includes clockwise winding
+  SHAPE_BAD_CHILD,   // a compound child that isn't a registered shape, or is a compound itself
+};
+
+struct shape_registry {
+  std::vector<shape> shapes;  // indexed by shape id
+  std::unordered_multimap<uint64_t, int> lookup;  // hash of the vertices and rounding to ids
+  std::vector<compound> compounds;  // referenced by compound shapes
+};
+
+// checks that vertices form a strictly convex counterclockwise polygon
+shape_error validate_polygon(const vec2* vertices, int count);
+
+// id of the shape with these vertices, a new shape is only registered if no identical one exists.
+// returns -1 if validate_polygon rejects the vertices
+int add_shape(shape_registry* registry, const vec2* vertices, int count);
+
+// polygon grown by rounding, returns -1 like add_shape
+int add_rounded_shape(shape_registry* registry, const vec2* vertices, int count,
+                      float32 rounding);
+
+// rectangle centered on the body origin, returns -1 unless both half extents are positive. the
+// same rectangle passed to add_shape as the vertices (-w, -h), (w, -h), (w, h), (-w, h) is
+// the same box
+int add_box(shape_registry* registry, float32 half_width, float32 half_height);
+
+// returns -1 unless radius is positive and, for capsules, the end points differ
+int add_circle(shape_registry* registry, vec2 center, float32 radius);
+int add_capsule(shape_registry* registry, vec2 p1, vec2 p2, float32 radius);
+
+// shape from any point cloud: points closer than weld_distance are merged, the convex hull is
+// taken and vertices within weld_distance of the line through their neighbors are dropped. hulls
+// with more than MAX_VERTICES vertices lose the corners that cut off the least area until they
+// fit. the vertices are shifted so the centroid is the body origin, centroid receives the
+// centroid in the coordinates of points so the body center can be placed there.
+// returns the shape id in id, or an error and leaves id untouched
+shape_error make_shape(shape_registry* registry, const vec2* points, int count,
+                       float32 weld_distance, int* id, vec2* centroid);
+
+// one shape made of several: child i is shape_ids[i] moved by offsets[i], then the whole is shifted
+// so its centroid is the body origin and centroid receives it in the coordinates of the offsets.
+// contacts report children by their index here. returns SHAPE_BAD_COUNT for no children or more
+// than MAX_CHILDREN, and leaves id untouched on errors. compounds are never shared, every call
+// registers a new one
+shape_error make_compound(shape_registry* registry, const int* shape_ids, const vec2* offsets,
+                          int count, int* id, vec2* centroid);
+
+inline const shape* get_shape(const shape_registry* registry, int id) {
+  return &registry->shapes[id];
+}
+
+inline const compound* get_compound(const shape_registry* registry, const shape* s) {
+  return s->compound < 0 ? nullptr : &registry->compounds[s->compound];
+}
+
+// calls visit with every child of c whose bounds overlap lower to upper, in body coordinates
+template <typename F>
+void query_compound(const compound* c, vec2 lower, vec2 upper, F visit) {
+  // median splits of at most MAX_CHILDREN leaves never hold more nodes than this on the stack
+  int stack[MAX_CHILDREN];
+  int size = 0;
+  stack[size++] = 0;
+  while (size > 0) {
+    const compound_node* node = &c->nodes[stack[--size]];
+    if (node->lower.x > upper.x || node->lower.y > upper.y || lower.x > node->upper.x ||
+        lower.y > node->upper.y) {
+      continue;
+    }
+    if (node->count == 0) {
+      stack[size++] = node->first + 1;
+      stack[size++] = node->first;
+    } else {
+      visit(node->first);
+    }
+  }
+}
+
+#endif  // SHAPE_H
@@ -0,0 +1,221 @@
+#include "snapshot.h"
+#include <string.h>
+
+static_assert(sizeof(snapshot_header) == 24, "snapshot header must not be padded");
+static_assert(sizeof(body_state) == 24, "body state must not be padded");
+static_assert(sizeof(contact_state) == 12 + 12 * MAX_MANIFOLD_POINTS,
+              "contact state must not be padded");
+static_assert(sizeof(overlap_state) == 8, "overlap state must not be padded");
+
+static uint8_t* put(uint8_t* out, const void* value, size_t size) {
+  memcpy(out, value, size);
+  return out + size;
+}
+
+static const uint8_t* get(const uint8_t* in, void* value, size_t size) {
+  memcpy(value, in, size);
+  return in + size;
+}
+
+static const uint8_t* readBody(const uint8_t* in, body* b) {
+  in = get(in, &b->center, sizeof(vec2));
+  in = get(in, &b->vel, sizeof(vec2));
+  in = get(in, &b->r, sizeof(float32));
+  return get(in, &b->w, sizeof(float32));
+}
+
+static const uint8_t* readContact(const uint8_t* in, contact_constraint* c) {
+  contact_state s;
+  in = get(in, &s, sizeof(s));
+  *c = contact_constraint();
+  c->index_a = s.index_a;
+  c->index_b = s.index_b;
+  c->point_count = s.point_count;
+  for (int j = 0; j < s.point_count; j++) {
+    c->points[j].key = s.keys[j];
+    c->points[j].normal_impulse = s.normal_impulse[j];
+    c->points[j].tangent_impulse = s.tangent_impulse[j];
+  }
+  return in;
+}
+
+static const uint8_t* readOverlap(const uint8_t* in, body_pair* p) {
+  overlap_state s;
+  in = get(in, &s, sizeof(s));
+  p->index_a = s.index_a;
+  p->index_b = s.index_b;
+  return in;
+}
+
+static snapshot_header readHeader(const void* buffer) {
+  snapshot_header header;
+  memcpy(&header, buffer, sizeof(header));
+  return header;
+}
+
+static size_t heightsOffset(const snapshot_header& header) {
+  return sizeof(header) + header.body_count * sizeof(body_state) +
+         header.contact_count * sizeof(contact_state) +
+         header.overlap_count * sizeof(overlap_state);
+}
+
+// contacts that would index out of the world or the point arrays
+static bool validContacts(const uint8_t* in, uint32_t count, uint32_t body_count) {
+  for (uint32_t i = 0; i < count; i++) {
+    contact_state s;
+    memcpy(&s, in + i * sizeof(s), sizeof(s));
+    if (s.index_a < 0 || s.index_b < 0 || (uint32_t)s.index_a >= body_count ||
+        (uint32_t)s.index_b >= body_count || s.point_count < 0 ||
+        s.point_count > MAX_MANIFOLD_POINTS) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// overlaps that would index out of the world or aren't in the strict pair order the merge of
+// senseOverlaps relies on
+static bool validOverlaps(const uint8_t* in, uint32_t count, uint32_t body_count) {
+  overlap_state previous = {-1, -1};
+  for (uint32_t i = 0; i < count; i++) {
+    overlap_state s;
+    memcpy(&s, in + i * sizeof(s), sizeof(s));
+    if (s.index_a < 0 || s.index_b <= s.index_a || (uint32_t)s.index_b >= body_count ||
+        s.index_a < previous.index_a ||
+        (s.index_a == previous.index_a && s.index_b <= previous.index_b)) {
+      return false;
+    }
+    previous = s;
+  }
+  return true;
+}
+
+size_t snapshot_size(const world* w) {
+  return sizeof(snapshot_header) + w->bodies.size() * sizeof(body_state) +
+         w->contacts.size() * sizeof(contact_state) + w->overlaps.size() * sizeof(overlap_state) +
+         w->field.heights.size() * sizeof(float32);
+}
+
+size_t save_snapshot(const world* w, void* buffer, size_t capacity) {
+  size_t size = snapshot_size(w);
+  if (size > capacity) {
+    return 0;
+  }
+  snapshot_header header;
+  header.version = SNAPSHOT_VERSION;
+  header.size = (uint32_t)size;
+  header.body_count = (uint32_t)w->bodies.size();
+  header.contact_count = (uint32_t)w->contacts.size();
+  header.overlap_count = (uint32_t)w->overlaps.size();
+  header.height_count = (uint32_t)w->field.heights.size();
+
+  // the buffer doesn't have to be aligned so states are assembled locally and copied out
+  uint8_t* out = (uint8_t*)buffer;
+  memcpy(out, &header, sizeof(header));
+  out += sizeof(header);
+  for (size_t i = 0; i < w->bodies.size(); i++) {
+    // field by field in body_state order, a local body_state would construct its float32s
+    const body* b = &w->bodies[i];
+    out = put(out, &b->center, sizeof(vec2));
+    out = put(out, &b->vel, sizeof(vec2));
+    out = put(out, &b->r, sizeof(float32));
+    out = put(out, &b->w, sizeof(float32));
+  }
+  for (size_t i = 0; i < w->contacts.size(); i++) {
+    const contact_constraint* c = &w->contacts[i];
+    contact_state s = {};
+    s.index_a = c->index_a;
+    s.index_b = c->index_b;
+    s.point_count = c->point_count;
+    for (int j = 0; j < c->point_count; j++) {
+      s.keys[j] = c->points[j].key;
+      s.normal_impulse[j] = c->points[j].normal_impulse;
+      s.tangent_impulse[j] = c->points[j].tangent_impulse;
+    }
+    memcpy(out, &s, sizeof(s));
+    out += sizeof(s);
+  }
+  for (size_t i = 0; i < w->overlaps.size(); i++) {
+    overlap_state s = {w->overlaps[i].index_a, w->overlaps[i].index_b};
+    out = put(out, &s, sizeof(s));
+  }
+  if (!w->field.heights.empty()) {
+    put(out, w->field.heights.data(), w->field.heights.size() * sizeof(float32));
+  }
+  return size;
+}
+
+bool restore_snapshot(world* w, const void* buffer, size_t size) {
+  if (size < sizeof(snapshot_header)) {
+    return false;
+  }
+  snapshot_header header = readHeader(buffer);
+  if (header.version != SNAPSHOT_VERSION || header.size != size ||
+      header.body_count != w->bodies.size() || header.height_count != w->field.heights.size() ||
+      size != sizeof(header) + header.body_count * sizeof(body_state) +
+                  header.contact_count * sizeof(contact_state) +
+                  header.overlap_count * sizeof(overlap_state) +
+                  header.height_count * sizeof(float32)) {
+    return false;
+  }
+  const uint8_t* in = (const uint8_t*)buffer + sizeof(header);
+  const uint8_t* contacts = in + header.body_count * sizeof(body_state);
+  if (!validContacts(contacts, header.contact_count, header.body_count) ||
+      !validOverlaps(contacts + header.contact_count * sizeof(contact_state),
+                     header.overlap_count, header.body_count)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < w->bodies.size(); i++) {
+    in = readBody(in, &w->bodies[i]);
+  }
+  w->contacts.resize(header.contact_count);
+  for (uint32_t i = 0; i < header.contact_count; i++) {
+    in = readContact(in, &w->contacts[i]);
+  }
+  w->overlaps.resize(header.overlap_count);
+  for (uint32_t i = 0; i < header.overlap_count; i++) {
+    in = readOverlap(in, &w->overlaps[i]);
+  }
+  if (header.height_count > 0) {
+    get(in, w->field.heights.data(), header.height_count * sizeof(float32));
+  }
+  w->overlap_events.clear();
+  mark_all_changed(w);
+  mark_heights_changed(w);
+  return true;
+}
+
+void restore_body_state(world* w, const void* buffer, int index) {
+  const uint8_t* in = (const uint8_t*)buffer + sizeof(snapshot_header) + index * sizeof(body_state);
+  readBody(in, &w->bodies[index]);
+  mark_body_changed(w, index);
+}
+
+int snapshot_contact_count(const void* buffer) {
+  return (int)readHeader(buffer).contact_count;
+}
+
+void read_snapshot_contact(const void* buffer, int index, contact_constraint* c) {
+  snapshot_header header = readHeader(buffer);
+  const uint8_t* in = (const uint8_t*)buffer + sizeof(header) +
+                      header.body_count * sizeof(body_state) + index * sizeof(contact_state);
+  readContact(in, c);
+}
+
+void restore_heights(world* w, const void* buffer) {
+  snapshot_header header = readHeader(buffer);
+  if (header.height_count > 0) {
+    memcpy(w->field.heights.data(), (const uint8_t*)buffer + heightsOffset(header),
+           header.height_count * sizeof(float32));
+  }
+  mark_heights_changed(w);
+}
+
+void save_heights(const world* w, void* buffer) {
+  snapshot_header header = readHeader(buffer);
+  if (header.height_count > 0) {
+    memcpy((uint8_t*)buffer + heightsOffset(header), w->field.heights.data(),
+           header.height_count * sizeof(float32));
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <stddef.h>
+#include <stdint.h>
+#include "world.h"
+
+// the state a world needs to continue stepping bit-identically, without the shapes and mass
+// properties that never change. a snapshot is one flat block: the header, one body_state for every
+// body in body order, one contact_state for every contact of the last step in pair order, then
+// one overlap_state for every sensor pair that overlapped in the last step, also in pair order,
+// and last the heights of the heightfield, which can be deformed while the world runs. all fields
+// are 4 byte words so the block has no padding and can be copied or sent as is
+
+#define SNAPSHOT_VERSION 3
+
+struct snapshot_header {
+  uint32_t version;
+  uint32_t size;  // bytes including the header
+  uint32_t body_count;
+  uint32_t contact_count;
+  uint32_t overlap_count;
+  uint32_t height_count;
+};
+
+struct body_state {
+  vec2 center;
+  vec2 vel;
+  float32 r;
+  float32 w;
+};
+
+// warm start data of a contact, enough for the next step to match and reuse its impulses
+struct contact_state {
+  int32_t index_a, index_b;
+  int32_t point_count;
+  uint32_t keys[MAX_MANIFOLD_POINTS];
+  float32 normal_impulse[MAX_MANIFOLD_POINTS];
+  float32 tangent_impulse[MAX_MANIFOLD_POINTS];
+};
+
+// a pair from world::overlaps, so the overlap events continue after a restore as if the world
+// had never left the saved step
+struct overlap_state {
+  int32_t index_a, index_b;
+};
+
+// bytes needed to save the current state of w
+size_t snapshot_size(const world* w);
+
+// returns the number of bytes written, or 0 if capacity is too small
+size_t save_snapshot(const world* w, void* buffer, size_t capacity);
+
+// the world must have the same bodies as when the snapshot was saved, returns false without
+// changing w if the snapshot doesn't match it. contacts only get their warm start data back,
+// everything else about them is recomputed by the next step. the overlap events of the last step
+// are cleared
+bool restore_snapshot(world* w, const void* buffer, size_t size);
+
+// pieces of a snapshot that was saved from w or already accepted by restore_snapshot, these
+// don't check the block again
+void restore_body_state(world* w, const void* buffer, int index);
+int snapshot_contact_count(const void* buffer);
+void read_snapshot_contact(const void* buffer, int index, contact_constraint* c);
+void restore_heights(world* w, const void* buffer);
+// overwrites the heights in a snapshot of w with the current ones
+void save_heights(const world* w, void* buffer);
+
+#endif  // SNAPSHOT_H
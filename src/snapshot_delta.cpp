@@ -0,0 +1,306 @@
+#include "snapshot_delta.h"
+#include <string.h>
+
+#define BODY_WORDS (int)(sizeof(body_state) / 4)
+#define CONTACT_WORDS (int)(sizeof(contact_state) / 4)
+// word offsets inside a contact_state
+#define CONTACT_KEYS 3
+#define CONTACT_NORMAL_IMPULSES (CONTACT_KEYS + MAX_MANIFOLD_POINTS)
+#define CONTACT_TANGENT_IMPULSES (CONTACT_NORMAL_IMPULSES + MAX_MANIFOLD_POINTS)
+#define MAX_VARINT_BYTES 5
+
+static_assert(BODY_WORDS <= 8, "changed body words must fit in a byte");
+
+static uint32_t loadWord(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, 4);
+  return value;
+}
+
+static void storeWord(uint8_t* p, uint32_t value) {
+  memcpy(p, &value, 4);
+}
+
+static snapshot_header loadHeader(const void* snapshot) {
+  snapshot_header header;
+  memcpy(&header, snapshot, sizeof(header));
+  return header;
+}
+
+static const uint8_t* bodyWords(const void* snapshot, int index) {
+  return (const uint8_t*)snapshot + sizeof(snapshot_header) + index * sizeof(body_state);
+}
+
+static const uint8_t* contactWords(const void* snapshot, const snapshot_header& header,
+                                   int index) {
+  return (const uint8_t*)snapshot + sizeof(snapshot_header) +
+         header.body_count * sizeof(body_state) + index * sizeof(contact_state);
+}
+
+static const uint8_t* overlapWords(const void* snapshot, const snapshot_header& header,
+                                   int index) {
+  return contactWords(snapshot, header, header.contact_count) + index * sizeof(overlap_state);
+}
+
+static const uint8_t* heightWords(const void* snapshot, const snapshot_header& header) {
+  return overlapWords(snapshot, header, header.overlap_count);
+}
+
+static uint8_t* putVarint(uint8_t* out, uint32_t value) {
+  while (value >= 0x80) {
+    *out++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = (uint8_t)value;
+  return out;
+}
+
+// bounds checked reads, ok is cleared instead of reading past the end
+struct deltaReader {
+  const uint8_t* p;
+  const uint8_t* end;
+  bool ok;
+
+  uint8_t byte() {
+    if (p == end) {
+      ok = false;
+      return 0;
+    }
+    return *p++;
+  }
+
+  uint32_t varint() {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 7 * MAX_VARINT_BYTES; shift += 7) {
+      uint8_t b = byte();
+      value |= (uint32_t)(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+        return value;
+      }
+    }
+    ok = false;
+    return 0;
+  }
+};
+
+static bool pairBefore(const uint8_t* p, const uint8_t* q) {
+  int32_t pa = (int32_t)loadWord(p);
+  int32_t qa = (int32_t)loadWord(q);
+  return pa < qa || (pa == qa && (int32_t)loadWord(p + 4) < (int32_t)loadWord(q + 4));
+}
+
+static bool samePair(const uint8_t* p, const uint8_t* q) {
+  return loadWord(p) == loadWord(q) && loadWord(p + 4) == loadWord(q + 4);
+}
+
+size_t max_delta_size(const void* target) {
+  snapshot_header header = loadHeader(target);
+  return 4 * MAX_VARINT_BYTES + (header.body_count + 7) / 8 +
+         header.body_count * (1 + BODY_WORDS * MAX_VARINT_BYTES) +
+         header.contact_count * (1 + (CONTACT_WORDS - 1) * MAX_VARINT_BYTES) +
+         (header.overlap_count + header.height_count) * 2 * MAX_VARINT_BYTES;
+}
+
+size_t encode_delta(const void* baseline, const void* target, void* delta, size_t capacity) {
+  snapshot_header base = loadHeader(baseline);
+  snapshot_header header = loadHeader(target);
+  if (base.body_count != header.body_count || base.height_count != header.height_count ||
+      capacity < max_delta_size(target)) {
+    return 0;
+  }
+
+  uint8_t* out = putVarint((uint8_t*)delta, header.body_count);
+  out = putVarint(out, header.contact_count);
+  out = putVarint(out, header.overlap_count);
+
+  uint8_t* changed = out;
+  memset(changed, 0, (header.body_count + 7) / 8);
+  out += (header.body_count + 7) / 8;
+  for (uint32_t i = 0; i < header.body_count; i++) {
+    const uint8_t* a = bodyWords(baseline, i);
+    const uint8_t* b = bodyWords(target, i);
+    if (memcmp(a, b, sizeof(body_state)) == 0) {
+      continue;
+    }
+    changed[i >> 3] |= (uint8_t)(1 << (i & 7));
+    uint8_t* mask = out++;
+    *mask = 0;
+    for (int k = 0; k < BODY_WORDS; k++) {
+      uint32_t x = loadWord(a + 4 * k) ^ loadWord(b + 4 * k);
+      if (x) {
+        *mask |= (uint8_t)(1 << k);
+        out = putVarint(out, x);
+      }
+    }
+  }
+
+  // both contact lists are in pair order so baseline contacts are found with one merge pass
+  uint32_t k = 0;
+  uint32_t previous_a = 0;
+  for (uint32_t i = 0; i < header.contact_count; i++) {
+    const uint8_t* c = contactWords(target, header, i);
+    while (k < base.contact_count && pairBefore(contactWords(baseline, base, k), c)) {
+      k++;
+    }
+    const uint8_t* match = nullptr;
+    if (k < base.contact_count && samePair(contactWords(baseline, base, k), c)) {
+      match = contactWords(baseline, base, k);
+    }
+
+    uint32_t index_a = loadWord(c);
+    uint32_t point_count = loadWord(c + 8);
+    out = putVarint(out, index_a - previous_a);
+    out = putVarint(out, loadWord(c + 4) - index_a);
+    *out++ = (uint8_t)(point_count | (match ? 4 : 0));
+    previous_a = index_a;
+
+    uint32_t match_count = match ? loadWord(match + 8) : 0;
+    const int offsets[3] = {CONTACT_KEYS, CONTACT_NORMAL_IMPULSES, CONTACT_TANGENT_IMPULSES};
+    for (uint32_t j = 0; j < point_count; j++) {
+      for (int f = 0; f < 3; f++) {
+        int word = 4 * (offsets[f] + j);
+        uint32_t reference = j < match_count ? loadWord(match + word) : 0;
+        out = putVarint(out, loadWord(c + word) ^ reference);
+      }
+    }
+  }
+
+  previous_a = 0;
+  for (uint32_t i = 0; i < header.overlap_count; i++) {
+    const uint8_t* o = overlapWords(target, header, i);
+    uint32_t index_a = loadWord(o);
+    out = putVarint(out, index_a - previous_a);
+    out = putVarint(out, loadWord(o + 4) - index_a);
+    previous_a = index_a;
+  }
+
+  const uint8_t* base_heights = heightWords(baseline, base);
+  const uint8_t* heights = heightWords(target, header);
+  uint32_t changed_heights = 0;
+  for (uint32_t i = 0; i < header.height_count; i++) {
+    changed_heights += loadWord(base_heights + 4 * i) != loadWord(heights + 4 * i);
+  }
+  out = putVarint(out, changed_heights);
+  uint32_t previous = 0;
+  for (uint32_t i = 0; i < header.height_count; i++) {
+    uint32_t x = loadWord(base_heights + 4 * i) ^ loadWord(heights + 4 * i);
+    if (x) {
+      out = putVarint(out, i - previous);
+      out = putVarint(out, x);
+      previous = i;
+    }
+  }
+  return out - (uint8_t*)delta;
+}
+
+size_t decode_delta(const void* baseline, const void* delta, size_t delta_size, void* target,
+                    size_t capacity) {
+  snapshot_header base = loadHeader(baseline);
+  deltaReader in = {(const uint8_t*)delta, (const uint8_t*)delta + delta_size, true};
+  snapshot_header header;
+  header.version = SNAPSHOT_VERSION;
+  header.body_count = in.varint();
+  header.contact_count = in.varint();
+  header.overlap_count = in.varint();
+  // every contact takes at least 3 bytes and every overlap 2
+  if (!in.ok || header.body_count != base.body_count || header.contact_count > delta_size ||
+      header.overlap_count > delta_size) {
+    return 0;
+  }
+  header.height_count = base.height_count;
+  size_t size = sizeof(header) + header.body_count * sizeof(body_state) +
+                header.contact_count * sizeof(contact_state) +
+                header.overlap_count * sizeof(overlap_state) +
+                header.height_count * sizeof(float32);
+  if (size > capacity) {
+    return 0;
+  }
+  header.size = (uint32_t)size;
+  memcpy(target, &header, sizeof(header));
+
+  size_t mask_bytes = (header.body_count + 7) / 8;
+  if ((size_t)(in.end - in.p) < mask_bytes) {
+    return 0;
+  }
+  const uint8_t* changed = in.p;
+  in.p += mask_bytes;
+  uint8_t* bodies = (uint8_t*)target + sizeof(header);
+  memcpy(bodies, bodyWords(baseline, 0), header.body_count * sizeof(body_state));
+  for (uint32_t i = 0; i < header.body_count; i++) {
+    if (!(changed[i >> 3] & (1 << (i & 7)))) {
+      continue;
+    }
+    uint8_t* b = bodies + i * sizeof(body_state);
+    uint8_t mask = in.byte();
+    for (int k = 0; k < BODY_WORDS; k++) {
+      if (mask & (1 << k)) {
+        storeWord(b + 4 * k, loadWord(b + 4 * k) ^ in.varint());
+      }
+    }
+  }
+
+  uint32_t k = 0;
+  uint32_t previous_a = 0;
+  for (uint32_t i = 0; i < header.contact_count; i++) {
+    uint8_t* c = (uint8_t*)contactWords(target, header, i);
+    memset(c, 0, sizeof(contact_state));
+    uint32_t index_a = previous_a + in.varint();
+    storeWord(c, index_a);
+    storeWord(c + 4, index_a + in.varint());
+    uint8_t flags = in.byte();
+    uint32_t point_count = flags & 3;
+    if (!in.ok || point_count > MAX_MANIFOLD_POINTS) {
+      return 0;
+    }
+    storeWord(c + 8, point_count);
+    previous_a = index_a;
+
+    const uint8_t* match = nullptr;
+    if (flags & 4) {
+      while (k < base.contact_count && pairBefore(contactWords(baseline, base, k), c)) {
+        k++;
+      }
+      if (k == base.contact_count || !samePair(contactWords(baseline, base, k), c)) {
+        return 0;
+      }
+      match = contactWords(baseline, base, k);
+    }
+
+    uint32_t match_count = match ? loadWord(match + 8) : 0;
+    const int offsets[3] = {CONTACT_KEYS, CONTACT_NORMAL_IMPULSES, CONTACT_TANGENT_IMPULSES};
+    for (uint32_t j = 0; j < point_count; j++) {
+      for (int f = 0; f < 3; f++) {
+        int word = 4 * (offsets[f] + j);
+        uint32_t reference = j < match_count ? loadWord(match + word) : 0;
+        storeWord(c + word, in.varint() ^ reference);
+      }
+    }
+  }
+
+  previous_a = 0;
+  for (uint32_t i = 0; i < header.overlap_count; i++) {
+    uint8_t* o = (uint8_t*)overlapWords(target, header, i);
+    uint32_t index_a = previous_a + in.varint();
+    storeWord(o, index_a);
+    storeWord(o + 4, index_a + in.varint());
+    previous_a = index_a;
+  }
+
+  uint8_t* heights = (uint8_t*)heightWords(target, header);
+  if (header.height_count > 0) {
+    memcpy(heights, heightWords(baseline, base), header.height_count * sizeof(float32));
+  }
+  uint32_t changed_heights = in.varint();
+  if (changed_heights > header.height_count) {
+    return 0;
+  }
+  uint32_t index = 0;
+  for (uint32_t i = 0; i < changed_heights; i++) {
+    index += in.varint();
+    if (index >= header.height_count) {
+      return 0;
+    }
+    storeWord(heights + 4 * index, loadWord(heights + 4 * index) ^ in.varint());
+  }
+  return in.ok ? size : 0;
+}
@@ -0,0 +1,31 @@
+#ifndef SNAPSHOT_DELTA_H
+#define SNAPSHOT_DELTA_H
+#include <stddef.h>
+#include "snapshot.h"
+
+// compact encoding of a snapshot relative to an older snapshot of the same world, for sending
+// state corrections over the network. body and contact words are XORed with the baseline so
+// small changes leave only low bits set, which are then written as variable length integers.
+// bodies whose state didn't change (static and resting bodies) only cost a bit in a bitmask.
+// contacts are matched to the baseline contact of the same pair
+//
+// layout: body, contact and overlap counts, one bit per body set if it changed, then for every
+// changed body a byte with a bit per changed word followed by the XORed words, then for every
+// contact the pair as deltas, a byte with the point count and whether it has a baseline contact,
+// and the XORed key and impulses of each point, then the overlapping pairs as deltas, then the
+// number of changed heights and each as an index delta and the XORed word. all counts and words
+// are LEB128 varints
+
+// upper bound on the size of the delta of target against any baseline
+size_t max_delta_size(const void* target);
+
+// returns the number of bytes written, or 0 if capacity is less than max_delta_size(target) or
+// the two snapshots don't have the same bodies and heightfield
+size_t encode_delta(const void* baseline, const void* target, void* delta, size_t capacity);
+
+// rebuilds the bit-exact target snapshot, returns its size or 0 if the delta is malformed, doesn't
+// belong to baseline or the target doesn't fit in capacity
+size_t decode_delta(const void* baseline, const void* delta, size_t delta_size, void* target,
+                    size_t capacity);
+
+#endif  // SNAPSHOT_DELTA_H
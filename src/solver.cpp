@@ -0,0 +1,230 @@
+#include "solver.h"
+#include "thread_pool.h"
+
+void color_constraints(constraint_graph* graph, const body* bodies, int body_count,
+                       const contact_constraint* constraints, int count) {
+  size_t words = (body_count + 63) / 64;
+  for (int c = 0; c < GRAPH_COLOR_COUNT; c++) {
+    graph->body_bits[c].assign(words, 0);
+  }
+  graph->colors.resize(count);
+  graph->order.resize(count);
+
+  int color_counts[GRAPH_COLOR_COUNT + 1] = {};
+  for (int i = 0; i < count; i++) {
+    int a = constraints[i].index_a;
+    int b = constraints[i].index_b;
+    // static bodies are never written by the solver so any number of colors can share them
+    bool dynamic_a = is_dynamic(bodies + a);
+    bool dynamic_b = is_dynamic(bodies + b);
+    uint64_t bit_a = (uint64_t)1 << (a & 63);
+    uint64_t bit_b = (uint64_t)1 << (b & 63);
+
+    int color = GRAPH_COLOR_COUNT;
+    for (int c = 0; c < GRAPH_COLOR_COUNT; c++) {
+      uint64_t* bits = graph->body_bits[c].data();
+      if ((dynamic_a && (bits[a >> 6] & bit_a)) || (dynamic_b && (bits[b >> 6] & bit_b))) {
+        continue;
+      }
+      if (dynamic_a) {
+        bits[a >> 6] |= bit_a;
+      }
+      if (dynamic_b) {
+        bits[b >> 6] |= bit_b;
+      }
+      color = c;
+      break;
+    }
+    graph->colors[i] = (uint8_t)color;
+    color_counts[color]++;
+  }
+
+  graph->color_offsets[0] = 0;
+  for (int c = 0; c <= GRAPH_COLOR_COUNT; c++) {
+    graph->color_offsets[c + 1] = graph->color_offsets[c] + color_counts[c];
+  }
+  // stable fill keeps constraint order inside each color
+  int cursor[GRAPH_COLOR_COUNT + 1];
+  for (int c = 0; c <= GRAPH_COLOR_COUNT; c++) {
+    cursor[c] = graph->color_offsets[c];
+  }
+  for (int i = 0; i < count; i++) {
+    graph->order[cursor[graph->colors[i]]++] = i;
+  }
+}
+
+void prepare_contacts(const body* bodies, contact_constraint* constraints, int count,
+                      float32 baumgarte, float32 slop, float32 restitution) {
+  for (int i = 0; i < count; i++) {
+    contact_constraint* c = constraints + i;
+    const body* a = bodies + c->index_a;
+    const body* b = bodies + c->index_b;
+    vec2 tangent = cross(c->normal, float32(1));
+
+    for (int j = 0; j < c->point_count; j++) {
+      contact_point_constraint* cp = c->points + j;
+      float32 rna = cross(cp->ra, c->normal);
+      float32 rnb = cross(cp->rb, c->normal);
+      float32 kn = a->inv_mass + b->inv_mass + a->inv_I * rna * rna + b->inv_I * rnb * rnb;
+      cp->normal_mass = kn > float32(0) ? float32(1) / kn : float32(0);
+
+      float32 rta = cross(cp->ra, tangent);
+      float32 rtb = cross(cp->rb, tangent);
+      float32 kt = a->inv_mass + b->inv_mass + a->inv_I * rta * rta + b->inv_I * rtb * rtb;
+      cp->tangent_mass = kt > float32(0) ? float32(1) / kt : float32(0);
+
+      // velocities are per step so a gap can be closed in one step and overlap is
+      // pushed out by a fraction of its depth
+      if (cp->separation > float32(0)) {
+        cp->velocity_bias = -cp->separation;
+      } else {
+        cp->velocity_bias = baumgarte * max(-cp->separation - slop, float32(0));
+      }
+
+      if (restitution > float32(0)) {
+        vec2 dv = b->vel + cross(b->w, cp->rb) - a->vel - cross(a->w, cp->ra);
+        float32 vn = dot(dv, c->normal);
+        if (vn < float32(0)) {
+          cp->velocity_bias = max(cp->velocity_bias, -restitution * vn);
+        }
+      }
+    }
+  }
+}
+
+static void warmStart(body* bodies, contact_constraint* c) {
+  body* a = bodies + c->index_a;
+  body* b = bodies + c->index_b;
+  vec2 tangent = cross(c->normal, float32(1));
+  vec2 va = a->vel;
+  float32 wa = a->w;
+  vec2 vb = b->vel;
+  float32 wb = b->w;
+
+  for (int j = 0; j < c->point_count; j++) {
+    contact_point_constraint* cp = c->points + j;
+    vec2 p = cp->normal_impulse * c->normal + cp->tangent_impulse * tangent;
+    va -= a->inv_mass * p;
+    wa -= a->inv_I * cross(cp->ra, p);
+    vb += b->inv_mass * p;
+    wb += b->inv_I * cross(cp->rb, p);
+  }
+
+  // static bodies may be shared within a color, never write to them
+  if (is_dynamic(a)) {
+    a->vel = va;
+    a->w = wa;
+  }
+  if (is_dynamic(b)) {
+    b->vel = vb;
+    b->w = wb;
+  }
+}
+
+void solve_contact(body* bodies, contact_constraint* c) {
+  body* a = bodies + c->index_a;
+  body* b = bodies + c->index_b;
+  vec2 tangent = cross(c->normal, float32(1));
+  vec2 va = a->vel;
+  float32 wa = a->w;
+  vec2 vb = b->vel;
+  float32 wb = b->w;
+
+  // friction first so that the normal constraint has the final say on penetration
+  for (int j = 0; j < c->point_count; j++) {
+    contact_point_constraint* cp = c->points + j;
+    vec2 dv = vb + cross(wb, cp->rb) - va - cross(wa, cp->ra);
+    float32 lambda = -cp->tangent_mass * dot(dv, tangent);
+
+    float32 max_friction = c->friction * cp->normal_impulse;
+    float32 total = clamp(cp->tangent_impulse + lambda, -max_friction, max_friction);
+    lambda = total - cp->tangent_impulse;
+    cp->tangent_impulse = total;
+
+    vec2 p = lambda * tangent;
+    va -= a->inv_mass * p;
+    wa -= a->inv_I * cross(cp->ra, p);
+    vb += b->inv_mass * p;
+    wb += b->inv_I * cross(cp->rb, p);
+  }
+
+  for (int j = 0; j < c->point_count; j++) {
+    contact_point_constraint* cp = c->points + j;
+    vec2 dv = vb + cross(wb, cp->rb) - va - cross(wa, cp->ra);
+    float32 lambda = cp->normal_mass * (cp->velocity_bias - dot(dv, c->normal));
+
+    float32 total = max(cp->normal_impulse + lambda, float32(0));
+    lambda = total - cp->normal_impulse;
+    cp->normal_impulse = total;
+
+    vec2 p = lambda * c->normal;
+    va -= a->inv_mass * p;
+    wa -= a->inv_I * cross(cp->ra, p);
+    vb += b->inv_mass * p;
+    wb += b->inv_I * cross(cp->rb, p);
+  }
+
+  if (is_dynamic(a)) {
+    a->vel = va;
+    a->w = wa;
+  }
+  if (is_dynamic(b)) {
+    b->vel = vb;
+    b->w = wb;
+  }
+}
+
+struct colorContext {
+  body* bodies;
+  contact_constraint* constraints;
+  const int* indices;
+  int count;
+  bool warm_start;
+};
+
+static void solveChunk(int chunk, void* context) {
+  colorContext* ctx = (colorContext*)context;
+  int begin = chunk * SOLVER_CHUNK_SIZE;
+  int end = begin + SOLVER_CHUNK_SIZE < ctx->count ? begin + SOLVER_CHUNK_SIZE : ctx->count;
+  for (int i = begin; i < end; i++) {
+    contact_constraint* c = ctx->constraints + ctx->indices[i];
+    if (ctx->warm_start) {
+      warmStart(ctx->bodies, c);
+    } else {
+      solve_contact(ctx->bodies, c);
+    }
+  }
+}
+
+static void solveColors(body* bodies, contact_constraint* constraints,
+                        const constraint_graph* graph, bool warm_start, thread_pool* pool) {
+  colorContext ctx;
+  ctx.bodies = bodies;
+  ctx.constraints = constraints;
+  ctx.warm_start = warm_start;
+
+  for (int c = 0; c <= GRAPH_COLOR_COUNT; c++) {
+    ctx.indices = graph->order.data() + graph->color_offsets[c];
+    ctx.count = graph->color_offsets[c + 1] - graph->color_offsets[c];
+    if (ctx.count == 0) {
+      continue;
+    }
+    int chunks = (ctx.count + SOLVER_CHUNK_SIZE - 1) / SOLVER_CHUNK_SIZE;
+    if (pool && c < GRAPH_COLOR_COUNT) {
+      pool->parallel_for(chunks, solveChunk, &ctx);
+    } else {
+      // overflow constraints may share bodies so they always run in order on this thread
+      for (int i = 0; i < chunks; i++) {
+        solveChunk(i, &ctx);
+      }
+    }
+  }
+}
+
+void solve_contacts(body* bodies, contact_constraint* constraints, const constraint_graph* graph,
+                    int iterations, thread_pool* pool) {
+  solveColors(bodies, constraints, graph, true, pool);
+  for (int i = 0; i < iterations; i++) {
+    solveColors(bodies, constraints, graph, false, pool);
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+#include <stdint.h>
+#include <vector>
+#include "collision.h"
+
+// constraints that can't find a free color go to a final overflow color that is solved serially
+#define GRAPH_COLOR_COUNT 12
+// number of constraints a worker claims at a time within a color, they are solved one after the
+// other. a larger chunk means fewer claims from the pool's shared counter
+#define SOLVER_CHUNK_SIZE 4
+
+struct thread_pool;
+
+struct contact_point_constraint {
+  vec2 ra, rb;  // contact point relative to the body centers
+  float32 separation;
+  float32 normal_mass;
+  float32 tangent_mass;
+  float32 velocity_bias;  // target normal velocity, speculative for gaps and push out for overlap
+  float32 normal_impulse = float32(0);   // accumulated, carried between steps for warm starting
+  float32 tangent_impulse = float32(0);
+  uint32_t key;  // manifold_point key
+};
+
+// contact manifold between two bodies solved with sequential impulses
+struct contact_constraint {
+  int index_a, index_b;  // body indices, index_a < index_b
+  vec2 normal;           // from a to b
+  float32 friction;
+  int point_count;
+  contact_point_constraint points[MAX_MANIFOLD_POINTS];
+};
+
+// constraints partitioned so that no two constraints of one color share a dynamic body.
+// colors are assigned greedily in constraint order, so the partition only depends on the input
+// and constraints within a color can be solved in any order (or in parallel) with the same result
+struct constraint_graph {
+  std::vector<int> order;  // constraint indices grouped by color, overflow color last
+  // color c spans order[color_offsets[c]] to order[color_offsets[c + 1]], the overflow color is
+  // index GRAPH_COLOR_COUNT
+  int color_offsets[GRAPH_COLOR_COUNT + 2];
+  std::vector<uint64_t> body_bits[GRAPH_COLOR_COUNT];  // bodies already used by each color
+  std::vector<uint8_t> colors;                         // color of each constraint
+};
+
+void color_constraints(constraint_graph* graph, const body* bodies, int body_count,
+                       const contact_constraint* constraints, int count);
+
+// compute effective masses and velocity bias from the current body velocities
+// baumgarte is the fraction of penetration beyond slop that is removed each step
+void prepare_contacts(const body* bodies, contact_constraint* constraints, int count,
+                      float32 baumgarte, float32 slop, float32 restitution);
+
+// warm start from the accumulated impulses and run the velocity iterations color by color,
+// results are bit-identical for any thread count (pool may be null)
+void solve_contacts(body* bodies, contact_constraint* constraints, const constraint_graph* graph,
+                    int iterations, thread_pool* pool);
+
+// one velocity iteration of a single constraint
+void solve_contact(body* bodies, contact_constraint* c);
+
+inline bool is_dynamic(const body* b) {
+  return b->inv_mass != float32(0) || b->inv_I != float32(0);
+}
+
+#endif  // SOLVER_H
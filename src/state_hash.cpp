@@ -0,0 +1,117 @@
+#include "state_hash.h"
+
+// splitmix64 finalizer
+static uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+static void stateWords(const body* b, uint32_t* words) {
+  words[STATE_CENTER_X] = b->center.x.v.v;
+  words[STATE_CENTER_Y] = b->center.y.v.v;
+  words[STATE_VEL_X] = b->vel.x.v.v;
+  words[STATE_VEL_Y] = b->vel.y.v.v;
+  words[STATE_ANGLE] = b->r.v.v;
+  words[STATE_ANGULAR_VEL] = b->w.v.v;
+}
+
+static uint64_t bodyHash(int index, const uint32_t* words) {
+  uint64_t h = mix((uint64_t)index + 1);
+  for (int i = 0; i < STATE_FIELD_COUNT; i++) {
+    h = mix(h ^ words[i]);
+  }
+  return h;
+}
+
+// 0 without a heightfield
+static uint64_t heightsHash(const heightfield* field) {
+  uint64_t h = 0;
+  for (size_t i = 0; i < field->heights.size(); i++) {
+    h = mix(h ^ field->heights[i].v.v);
+  }
+  return h;
+}
+
+static void rehashBody(state_hash* h, const world* w, int index) {
+  uint32_t* words = h->words.data() + index * STATE_FIELD_COUNT;
+  stateWords(&w->bodies[index], words);
+  uint64_t body_hash = bodyHash(index, words);
+  h->value += body_hash - h->body_hashes[index];
+  h->body_hashes[index] = body_hash;
+}
+
+int update_state_hash(state_hash* h, const world* w) {
+  int count = (int)w->bodies.size();
+  const std::vector<int>& changed = w->changed_bodies;
+  int rehashed = 0;
+  size_t end = w->changed_base + changed.size();
+  bool full = h->generation != w->generation.value || h->seen < w->changed_base || h->seen > end ||
+              (int)h->body_hashes.size() != count;
+  if (full) {
+    h->value = 0;
+    h->heights_hash = 0;
+    h->words.assign(count * STATE_FIELD_COUNT, 0);
+    h->body_hashes.assign(count, 0);
+    for (int i = 0; i < count; i++) {
+      rehashBody(h, w, i);
+    }
+    rehashed = count;
+  } else {
+    for (size_t i = h->seen - w->changed_base; i < changed.size(); i++) {
+      rehashBody(h, w, changed[i]);
+    }
+    rehashed = (int)(end - h->seen);
+  }
+  if (full || h->heights_version != w->heights_version) {
+    uint64_t heights_hash = heightsHash(&w->field);
+    h->value += heights_hash - h->heights_hash;
+    h->heights_hash = heights_hash;
+  }
+  h->generation = w->generation.value;
+  h->seen = end;
+  h->heights_version = w->heights_version;
+  return rehashed;
+}
+
+bool diff_state(const state_hash* a, const state_hash* b, state_divergence* d) {
+  int count_a = (int)a->body_hashes.size();
+  int count_b = (int)b->body_hashes.size();
+  int count = count_a < count_b ? count_a : count_b;
+  for (int i = 0; i < count; i++) {
+    if (a->body_hashes[i] == b->body_hashes[i]) {
+      continue;
+    }
+    const uint32_t* words_a = a->words.data() + i * STATE_FIELD_COUNT;
+    const uint32_t* words_b = b->words.data() + i * STATE_FIELD_COUNT;
+    for (int f = 0; f < STATE_FIELD_COUNT; f++) {
+      if (words_a[f] != words_b[f]) {
+        d->body = i;
+        d->field = (state_field)f;
+        d->bits_a = words_a[f];
+        d->bits_b = words_b[f];
+        return true;
+      }
+    }
+  }
+  if (count_a != count_b || a->heights_hash != b->heights_hash) {
+    d->body = count_a != count_b ? count : -1;
+    d->field = count_a != count_b ? STATE_FIELD_COUNT : STATE_HEIGHTS;
+    d->bits_a = 0;
+    d->bits_b = 0;
+    return true;
+  }
+  return false;
+}
+
+const char* state_field_name(state_field field) {
+  static const char* names[STATE_FIELD_COUNT] = {
+      "center.x", "center.y", "vel.x", "vel.y", "r", "w",
+  };
+  if (field == STATE_HEIGHTS) {
+    return "heights";
+  }
+  return field < STATE_FIELD_COUNT ? names[field] : "missing body";
+}
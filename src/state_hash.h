@@ -0,0 +1,53 @@
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+#include <stdint.h>
+#include <vector>
+#include "world.h"
+
+// 64 bit hash of the dynamic state of a world for lockstep desync detection. the hash is built
+// from the raw float32_t bits of each body so equal hashes mean bit-identical state. every body
+// has its own hash that includes its index, the world hash is their sum so an update only rehashes
+// the bodies in the change log of the world (see world::changed_bodies). the heights of the
+// heightfield are hashed as one more term, again when mark_heights_changed was called
+
+enum state_field {
+  STATE_CENTER_X,
+  STATE_CENTER_Y,
+  STATE_VEL_X,
+  STATE_VEL_Y,
+  STATE_ANGLE,
+  STATE_ANGULAR_VEL,
+  STATE_FIELD_COUNT,
+  STATE_HEIGHTS,  // not a body field, the heightfield differs
+};
+
+struct state_hash {
+  uint64_t value = 0;
+  std::vector<uint32_t> words;         // STATE_FIELD_COUNT bits per body as of the last update
+  std::vector<uint64_t> body_hashes;
+  uint64_t heights_hash = 0;
+  // world generation and change log position, counted from the creation of the world, the hash
+  // is up to date with. generations start at 1
+  uint64_t generation = 0;
+  size_t seen = 0;
+  uint32_t heights_version = 0;
+};
+
+// bring h up to date with w, returns the number of bodies that were rehashed. the first update,
+// one for another world or generation, after the body count changed or the change log dropped
+// entries h hadn't seen, rehashes every body
+int update_state_hash(state_hash* h, const world* w);
+
+struct state_divergence {
+  int body;           // -1 for STATE_HEIGHTS
+  state_field field;  // STATE_FIELD_COUNT if body only exists on one side
+  uint32_t bits_a, bits_b;
+};
+
+// finds the first body and field where two hashes were built from different states, or the
+// heights if only they differ. returns false if there is none
+bool diff_state(const state_hash* a, const state_hash* b, state_divergence* d);
+
+const char* state_field_name(state_field field);
+
+#endif  // STATE_HASH_H
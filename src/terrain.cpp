@@ -0,0 +1,106 @@
+#include "terrain.h"
+#include <algorithm>
+
+bool add_chain(chain_terrain* t, const vec2* points, int count, bool loop) {
+  if (count < (loop ? 3 : 2)) {
+    return false;
+  }
+  int edge_count = loop ? count : count - 1;
+  for (int i = 0; i < edge_count; i++) {
+    vec2 d = points[(i + 1) % count] - points[i];
+    if (dot(d, d) == float32(0)) {
+      return false;
+    }
+  }
+
+  for (int i = 0; i < edge_count; i++) {
+    chain_edge e;
+    e.v0 = points[i];
+    e.v1 = points[(i + 1) % count];
+    e.ghost0 = loop || i > 0 ? points[(i + count - 1) % count] : e.v0;
+    e.ghost1 = loop || i + 2 < count ? points[(i + 2) % count] : e.v1;
+    e.normal = normalize(cross(float32(1), e.v1 - e.v0));
+    t->edges.push_back(e);
+  }
+  return true;
+}
+
+chain_edge heightfield_edge(const heightfield* h, int cell) {
+  assert(float32(0) < h->spacing);
+  int last = (int)h->heights.size() - 1;
+  chain_edge e;
+  e.v0 = h->origin + vec2(float32(cell) * h->spacing, h->heights[cell]);
+  e.v1 = h->origin + vec2(float32(cell + 1) * h->spacing, h->heights[cell + 1]);
+  e.ghost0 = cell > 0 ? h->origin + vec2(float32(cell - 1) * h->spacing, h->heights[cell - 1])
+                      : e.v0;
+  e.ghost1 = cell + 1 < last
+                 ? h->origin + vec2(float32(cell + 2) * h->spacing, h->heights[cell + 2])
+                 : e.v1;
+  e.normal = normalize(cross(float32(1), e.v1 - e.v0));
+  return e;
+}
+
+// edges are compared by twice their midpoint along axis, then by their vertices and ghosts so
+// only identical edges tie and the unstable sort gives the same result everywhere
+static bool edgeBefore(const chain_edge& p, const chain_edge& q, int axis) {
+  float32 pa = axis ? p.v0.y + p.v1.y : p.v0.x + p.v1.x;
+  float32 qa = axis ? q.v0.y + q.v1.y : q.v0.x + q.v1.x;
+  if (pa != qa) {
+    return pa < qa;
+  }
+  const vec2 pv[4] = {p.v0, p.v1, p.ghost0, p.ghost1};
+  const vec2 qv[4] = {q.v0, q.v1, q.ghost0, q.ghost1};
+  for (int i = 0; i < 4; i++) {
+    if (pv[i].x != qv[i].x) {
+      return pv[i].x < qv[i].x;
+    }
+    if (pv[i].y != qv[i].y) {
+      return pv[i].y < qv[i].y;
+    }
+  }
+  return false;
+}
+
+// median split of edges first to first + count along the longer side of their midpoints' bounds
+static void buildNode(chain_terrain* t, int index, int first, int count) {
+  vec2 lower = t->edges[first].v0;
+  vec2 upper = lower;
+  vec2 mid_lower = t->edges[first].v0 + t->edges[first].v1;
+  vec2 mid_upper = mid_lower;
+  for (int i = first; i < first + count; i++) {
+    const chain_edge* e = &t->edges[i];
+    vec2 mid = e->v0 + e->v1;
+    lower = vec2(min(lower.x, min(e->v0.x, e->v1.x)), min(lower.y, min(e->v0.y, e->v1.y)));
+    upper = vec2(max(upper.x, max(e->v0.x, e->v1.x)), max(upper.y, max(e->v0.y, e->v1.y)));
+    mid_lower = vec2(min(mid_lower.x, mid.x), min(mid_lower.y, mid.y));
+    mid_upper = vec2(max(mid_upper.x, mid.x), max(mid_upper.y, mid.y));
+  }
+  t->nodes[index].lower = lower;
+  t->nodes[index].upper = upper;
+  if (count <= TERRAIN_LEAF_EDGES) {
+    t->nodes[index].first = first;
+    t->nodes[index].count = count;
+    return;
+  }
+
+  int axis = mid_upper.y - mid_lower.y > mid_upper.x - mid_lower.x ? 1 : 0;
+  std::vector<chain_edge>::iterator begin = t->edges.begin() + first;
+  std::sort(begin, begin + count, [axis](const chain_edge& p, const chain_edge& q) {
+    return edgeBefore(p, q, axis);
+  });
+  int left = (int)t->nodes.size();
+  t->nodes.resize(left + 2);
+  t->nodes[index].first = left;
+  t->nodes[index].count = 0;
+  buildNode(t, left, first, count / 2);
+  buildNode(t, left + 1, first + count / 2, count - count / 2);
+}
+
+void build_terrain(chain_terrain* t) {
+  t->nodes.clear();
+  if (t->edges.empty()) {
+    return;
+  }
+  t->nodes.resize(1);
+  buildNode(t, 0, 0, (int)t->edges.size());
+}
@@ -0,0 +1,112 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+#include "collision.h"
+
+// static level geometry: chains of edges kept in a bounding volume hierarchy that is built once
+// and only read afterwards, so finding the edges around a body takes time logarithmic in the
+// number of edges. a chain's surface is on the left of the direction its points are listed in:
+// ground runs left to right, a solid loop runs clockwise and a room is a counterclockwise loop
+
+#define TERRAIN_LEAF_EDGES 4
+#define TERRAIN_MAX_DEPTH 64  // far deeper than any hierarchy built by median splits
+// chain edges and heightfield cells of one world, contact keys have 20 bits for the edge
+#define TERRAIN_MAX_EDGES (1 << 20)
+
+struct terrain_node {
+  vec2 lower, upper;
+  int first;  // first edge of a leaf, left child of an inner node with the right child after it
+  int count;  // edges in a leaf, 0 for inner nodes
+};
+
+struct chain_terrain {
+  std::vector<chain_edge> edges;
+  std::vector<terrain_node> nodes;  // root first, empty until build_terrain
+};
+
+// appends the edges of the chain through points, loop closes it from the last point back to the
+// first. returns false and adds nothing if there are fewer than 2 points (3 for a loop) or two
+// consecutive points are equal
+bool add_chain(chain_terrain* t, const vec2* points, int count, bool loop);
+
+// builds the hierarchy over every edge added so far. edges are reordered so each leaf holds a
+// range of them, the order only depends on the edges so every platform builds the same terrain
+void build_terrain(chain_terrain* t);
+
+// ground given as heights sampled at a uniform spacing along x, the surface faces up. the cell
+// between two samples collides like a chain edge built on the fly, nothing is derived from the
+// heights so deforming the ground is a store into heights followed by mark_heights_changed on the
+// world. like edges the cells are one sided, ground raised above a body's center lets the body
+// fall through
+struct heightfield {
+  vec2 origin = {float32(0), float32(0)};  // sample i is at origin + (i * spacing, heights[i])
+  float32 spacing = float32(1);
+  std::vector<float32> heights;
+};
+
+// the cell from sample cell to cell + 1 as an edge, with the samples around it as ghosts. like
+// query_heightfield it needs a positive spacing, which finish_terrain checks
+chain_edge heightfield_edge(const heightfield* h, int cell);
+
+// calls visit with the index of every edge whose bounds overlap lower to upper
+template <typename F>
+void query_terrain(const chain_terrain* t, vec2 lower, vec2 upper, F visit) {
+  if (t->nodes.empty()) {
+    return;
+  }
+  int stack[TERRAIN_MAX_DEPTH];
+  int size = 0;
+  stack[size++] = 0;
+  while (size > 0) {
+    const terrain_node* node = &t->nodes[stack[--size]];
+    if (node->lower.x > upper.x || node->lower.y > upper.y || lower.x > node->upper.x ||
+        lower.y > node->upper.y) {
+      continue;
+    }
+    if (node->count == 0) {
+      assert(size + 2 <= TERRAIN_MAX_DEPTH);
+      stack[size++] = node->first + 1;
+      stack[size++] = node->first;
+      continue;
+    }
+    for (int i = node->first; i < node->first + node->count; i++) {
+      const chain_edge* e = &t->edges[i];
+      if (min(e->v0.x, e->v1.x) > upper.x || min(e->v0.y, e->v1.y) > upper.y ||
+          lower.x > max(e->v0.x, e->v1.x) || lower.y > max(e->v0.y, e->v1.y)) {
+        continue;
+      }
+      visit(i);
+    }
+  }
+}
+
+// calls visit with every cell in the columns under lower to upper whose bounds overlap it
+template <typename F>
+void query_heightfield(const heightfield* h, vec2 lower, vec2 upper, F visit) {
+  int cells = (int)h->heights.size() - 1;
+  if (cells < 1) {
+    return;
+  }
+  assert(float32(0) < h->spacing);
+  float32 end = h->origin.x + float32(cells) * h->spacing;
+  if (upper.x < h->origin.x || lower.x > end) {
+    return;
+  }
+  // clamped before the conversion so bounds reaching far past the field can't overflow it
+  float32 x0 = clamp((lower.x - h->origin.x) / h->spacing, float32(0), float32(cells));
+  float32 x1 = clamp((upper.x - h->origin.x) / h->spacing, float32(0), float32(cells));
+  int first = std::min((int)f32_to_i32(x0, softfloat_round_min, false), cells - 1);
+  int last = std::min((int)f32_to_i32(x1, softfloat_round_min, false), cells - 1);
+  for (int i = first; i <= last; i++) {
+    float32 y0 = h->origin.y + h->heights[i];
+    float32 y1 = h->origin.y + h->heights[i + 1];
+    if (min(y0, y1) > upper.y || lower.y > max(y0, y1)) {
+      continue;
+    }
+    visit(i);
+  }
+}
+
+#endif  // TERRAIN_H
@@ -0,0 +1,69 @@
+#include "thread_pool.h"
+
+thread_pool::thread_pool(int thread_count) : next_index(0) {
+  for (int i = 1; i < thread_count; i++) {
+    workers.emplace_back(&thread_pool::worker_loop, this);
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+}
+
+void thread_pool::parallel_for(int count, task_fn fn, void* context) {
+  // not worth waking anybody up
+  if (workers.empty() || count <= 1) {
+    for (int i = 0; i < count; i++) {
+      fn(i, context);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job_fn = fn;
+    job_context = context;
+    job_count = count;
+    next_index.store(0);
+    active = (int)workers.size();
+    generation++;
+  }
+  wake.notify_all();
+
+  work();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [this] { return active == 0; });
+}
+
+void thread_pool::work() {
+  int i;
+  while ((i = next_index.fetch_add(1)) < job_count) {
+    job_fn(i, job_context);
+  }
+}
+
+void thread_pool::worker_loop() {
+  unsigned long seen = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (1) {
+    wake.wait(lock, [&] { return stop || generation != seen; });
+    if (stop) {
+      return;
+    }
+    seen = generation;
+    lock.unlock();
+    work();
+    lock.lock();
+    if (--active == 0) {
+      done.notify_one();
+    }
+  }
+}
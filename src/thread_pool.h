@@ -0,0 +1,40 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef void (*task_fn)(int index, void* context);
+
+// fixed set of worker threads that run indexed tasks, the calling thread also takes part
+struct thread_pool {
+  // thread_count includes the calling thread, so 1 means no workers are spawned
+  explicit thread_pool(int thread_count);
+  ~thread_pool();
+
+  // run fn(i, context) for every i in [0, count) and return once all of them have finished
+  // tasks are claimed in any order, callers must not depend on which thread runs which index
+  void parallel_for(int count, task_fn fn, void* context);
+  int size() const { return (int)workers.size() + 1; }
+
+ private:
+  void work();
+  void worker_loop();
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  unsigned long generation = 0;  // bumped for every parallel_for so sleeping workers notice
+  int active = 0;                // workers still inside the current job
+  bool stop = false;
+
+  task_fn job_fn = nullptr;
+  void* job_context = nullptr;
+  int job_count = 0;
+  std::atomic<int> next_index;
+};
+
+#endif  // THREAD_POOL_H
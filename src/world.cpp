@@ -0,0 +1,965 @@
+#include "world.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include "math_util.h"
+
+int add_body(world* w, const body& b) {
+  int index = (int)w->bodies.size();
+  w->bodies.push_back(b);
+  if (b.id < 0) {
+    w->bodies.back().id = index;
+  }
+  return index;
+}
+
+void set_body_mass(body* b, const shape* s, float32 density) {
+  if (density == float32(0)) {
+    b->inv_mass = float32(0);
+    b->inv_I = float32(0);
+    return;
+  }
+  b->inv_mass = float32(1) / (density * s->area);
+  b->inv_I = float32(1) / (density * s->inertia);
+}
+
+void apply_input(world* w, const body_input& input) {
+  body* b = &w->bodies[input.body];
+  b->vel += b->inv_mass * input.impulse;
+  b->w += b->inv_I * input.angular_impulse;
+  mark_body_changed(w, input.body);
+}
+
+// a step adds at most one entry per body. a full log drops its older half, which still holds the
+// last step, so hashes updated every step never fall behind it. it only reallocates when bodies
+// are added
+static size_t changedCapacity(const world* w) {
+  return 2 * w->bodies.size() + 64;
+}
+
+uint64_t next_world_generation() {
+  static std::atomic<uint64_t> next(1);
+  return next++;
+}
+
+void mark_body_changed(world* w, int index) {
+  std::vector<int>* changed = &w->changed_bodies;
+  size_t capacity = changedCapacity(w);
+  if (changed->capacity() < capacity) {
+    changed->reserve(capacity);
+  }
+  if (changed->size() >= capacity) {
+    size_t dropped = changed->size() / 2;
+    changed->erase(changed->begin(), changed->begin() + dropped);
+    w->changed_base += dropped;
+  }
+  changed->push_back(index);
+}
+
+void mark_all_changed(world* w) {
+  w->changed_base += w->changed_bodies.size();
+  w->changed_bodies.clear();
+  w->generation.value = next_world_generation();
+}
+
+void mark_heights_changed(world* w) {
+  w->heights_version++;
+}
+
+int finish_terrain(world* w, float32 friction) {
+  const heightfield* field = &w->field;
+  // written with < so a NaN spacing fails too, > is the negation of <= for float32
+  if (!field->heights.empty() && (field->heights.size() < 2 || !(float32(0) < field->spacing))) {
+    return -1;
+  }
+  size_t cells = field->heights.empty() ? 0 : field->heights.size() - 1;
+  if (w->terrain.edges.size() + cells > TERRAIN_MAX_EDGES) {
+    return -1;
+  }
+  if (w->terrain_body < 0) {
+    w->terrain_body = add_body(w, body());
+  }
+  w->bodies[w->terrain_body].friction = friction;
+  build_terrain(&w->terrain);
+  return w->terrain_body;
+}
+
+// null for the terrain body
+static const shape* shapeOf(const world* w, int index) {
+  int id = w->bodies[index].shape_id;
+  return id < 0 ? nullptr : get_shape(&w->shapes, id);
+}
+
+static const compound* compoundOf(const world* w, int index) {
+  const shape* s = shapeOf(w, index);
+  return s ? get_compound(&w->shapes, s) : nullptr;
+}
+
+static int partCount(const world* w, int index) {
+  const compound* c = compoundOf(w, index);
+  return c ? c->child_count : 1;
+}
+
+// the convex parts of a body are the children of a compound, or its own shape as child 0
+static const shape* partShape(const world* w, int index, int child) {
+  const compound* c = compoundOf(w, index);
+  return c ? get_shape(&w->shapes, c->children[child]) : shapeOf(w, index);
+}
+
+static void applyGravity(world* w) {
+  for (size_t i = 0; i < w->bodies.size(); i++) {
+    body* b = &w->bodies[i];
+    if (b->inv_mass > float32(0)) {
+      b->vel += w->params.gravity;
+    }
+  }
+}
+
+// bounds covering the body over the whole step for any rotation. a body without a shape gets
+// inverted bounds that never overlap anything
+static void computeBounds(world* w) {
+  int n = (int)w->bodies.size();
+  w->bounds = arena_array<vec2>(&w->scratch, 2 * n);
+  for (int i = 0; i < n; i++) {
+    const body* b = &w->bodies[i];
+    const shape* s = shapeOf(w, i);
+    if (!s) {
+      float32 huge = F32_MAX;
+      w->bounds[2 * i] = vec2(huge, huge);
+      w->bounds[2 * i + 1] = vec2(-huge, -huge);
+      continue;
+    }
+    float32 extent = s->radius + w->params.contact_margin;
+    vec2 c0 = b->center;
+    vec2 c1 = b->center + b->vel;
+    w->bounds[2 * i] = vec2(min(c0.x, c1.x) - extent, min(c0.y, c1.y) - extent);
+    w->bounds[2 * i + 1] = vec2(max(c0.x, c1.x) + extent, max(c0.y, c1.y) + extent);
+  }
+}
+
+static bool bodyPairBefore(const body_pair& p, const body_pair& q) {
+  return p.index_a < q.index_a || (p.index_a == q.index_a && p.index_b < q.index_b);
+}
+
+// sort and sweep along x
+static void findPairs(world* w) {
+  int n = (int)w->bodies.size();
+  computeBounds(w);
+
+  w->proxies = arena_array<int>(&w->scratch, n);
+  for (int i = 0; i < n; i++) {
+    w->proxies[i] = i;
+  }
+  const vec2* bounds = w->bounds;
+  std::sort(w->proxies, w->proxies + n, [bounds](int a, int b) {
+    float32 xa = bounds[2 * a].x;
+    float32 xb = bounds[2 * b].x;
+    return xa < xb || (xa == xb && a < b);
+  });
+
+  w->pairs.clear();
+  w->sensor_pairs.clear();
+  for (int i = 0; i < n; i++) {
+    int a = w->proxies[i];
+    bool dynamic_a = is_dynamic(&w->bodies[a]);
+    bool sensor_a = w->bodies[a].sensor;
+    for (int j = i + 1; j < n; j++) {
+      int b = w->proxies[j];
+      if (bounds[2 * b].x > bounds[2 * a + 1].x) {
+        break;
+      }
+      if (bounds[2 * b].y > bounds[2 * a + 1].y || bounds[2 * a].y > bounds[2 * b + 1].y) {
+        continue;
+      }
+      if (!dynamic_a && !is_dynamic(&w->bodies[b])) {
+        continue;
+      }
+      if (sensor_a && w->bodies[b].sensor) {
+        continue;
+      }
+      if (!should_collide(w->bodies[a].filter, w->bodies[b].filter)) {
+        continue;
+      }
+      body_pair p;
+      p.index_a = a < b ? a : b;
+      p.index_b = a < b ? b : a;
+      if (w->filter && !w->filter(w, p.index_a, p.index_b, w->filter_user)) {
+        continue;
+      }
+      if (sensor_a || w->bodies[b].sensor) {
+        w->sensor_pairs.push_back(p);
+      } else {
+        w->pairs.push_back(p);
+      }
+    }
+  }
+
+  // canonical order so everything downstream is independent of the sweep
+  std::sort(w->pairs.begin(), w->pairs.end(), bodyPairBefore);
+  std::sort(w->sensor_pairs.begin(), w->sensor_pairs.end(), bodyPairBefore);
+}
+
+static bool isSimulated(const world* w, int index) {
+  return is_dynamic(&w->bodies[index]) && !w->frozen[index];
+}
+
+// wake frozen bodies linked to a simulated dynamic body through any chain of pairs, then drop the
+// pairs that are left without one
+static void wakeFrozen(world* w) {
+  if (w->frozen.empty()) {
+    return;
+  }
+  bool woke = true;
+  while (woke) {
+    woke = false;
+    for (size_t i = 0; i < w->pairs.size(); i++) {
+      int a = w->pairs[i].index_a;
+      int b = w->pairs[i].index_b;
+      bool simulated_a = isSimulated(w, a);
+      bool simulated_b = isSimulated(w, b);
+      if (simulated_a && w->frozen[b]) {
+        w->frozen[b] = 0;
+        woke = true;
+      } else if (simulated_b && w->frozen[a]) {
+        w->frozen[a] = 0;
+        woke = true;
+      }
+    }
+  }
+
+  size_t kept = 0;
+  for (size_t i = 0; i < w->pairs.size(); i++) {
+    if (isSimulated(w, w->pairs[i].index_a) || isSimulated(w, w->pairs[i].index_b)) {
+      w->pairs[kept++] = w->pairs[i];
+    }
+  }
+  w->pairs.resize(kept);
+}
+
+// the terrain hierarchy is queried with the swept bounds of every simulated dynamic body
+static void findTerrainPairs(world* w) {
+  w->terrain_pairs.clear();
+  if (w->terrain_body < 0) {
+    return;
+  }
+  std::vector<terrain_pair>* pairs = &w->terrain_pairs;
+  const collision_filter& terrain_filter = w->bodies[w->terrain_body].filter;
+  for (int i = 0; i < (int)w->bodies.size(); i++) {
+    if (!is_dynamic(&w->bodies[i]) || (!w->frozen.empty() && w->frozen[i]) ||
+        w->bodies[i].sensor) {
+      continue;
+    }
+    if (!should_collide(w->bodies[i].filter, terrain_filter)) {
+      continue;
+    }
+    int low = i < w->terrain_body ? i : w->terrain_body;
+    int high = i < w->terrain_body ? w->terrain_body : i;
+    if (w->filter && !w->filter(w, low, high, w->filter_user)) {
+      continue;
+    }
+    query_terrain(&w->terrain, w->bounds[2 * i], w->bounds[2 * i + 1], [pairs, i](int edge) {
+      terrain_pair p;
+      p.index = i;
+      p.edge = edge;
+      pairs->push_back(p);
+    });
+    int cell_offset = (int)w->terrain.edges.size();
+    query_heightfield(&w->field, w->bounds[2 * i], w->bounds[2 * i + 1],
+                      [pairs, i, cell_offset](int cell) {
+                        terrain_pair p;
+                        p.index = i;
+                        p.edge = cell_offset + cell;
+                        pairs->push_back(p);
+                      });
+  }
+}
+
+// world bounds of the part of b within extent of center, given in body coordinates, at the start
+// of the step or over all of it when swept. the center moves along vel and strays from that line
+// by at most the arc the rotation sweeps
+static void partBounds(const body* b, vec2 center, float32 extent, bool swept, vec2* lower,
+                       vec2* upper) {
+  mat22 rot;
+  rot.set(b->r);
+  vec2 p0 = b->center + mul(rot, center);
+  vec2 p1 = p0;
+  if (swept) {
+    p1 = p0 + b->vel;
+    extent += abs(b->w) * magnitude(center);
+  }
+  *lower = vec2(min(p0.x, p1.x) - extent, min(p0.y, p1.y) - extent);
+  *upper = vec2(max(p0.x, p1.x) + extent, max(p0.y, p1.y) + extent);
+}
+
+// bounds in the coordinates of b of the world box lower to upper, at the start of the step or over
+// all of it when swept. a point of the box moves relative to the body by at most vel plus the arc
+// the rotation sweeps at its distance from the center
+static void localBounds(const body* b, vec2 lower, vec2 upper, bool swept, vec2* local_lower,
+                        vec2* local_upper) {
+  mat22 rot;
+  rot.set(b->r);
+  vec2 q = mul_transpose(rot, float32(0.5f) * (lower + upper) - b->center);
+  float32 extent = magnitude(float32(0.5f) * (upper - lower));
+  if (swept) {
+    extent = extent + magnitude(b->vel) + abs(b->w) * (magnitude(q) + extent);
+  }
+  *local_lower = q - vec2(extent, extent);
+  *local_upper = q + vec2(extent, extent);
+}
+
+// calls visit with every part of the body at index, posed as b, that may overlap the world box
+// lower to upper. the single part of a plain body isn't tested, its bounds were
+template <typename F>
+static void visitParts(const world* w, int index, const body* b, vec2 lower, vec2 upper,
+                       bool swept, F visit) {
+  const compound* c = compoundOf(w, index);
+  if (!c) {
+    visit(0);
+    return;
+  }
+  vec2 local_lower, local_upper;
+  localBounds(b, lower, upper, swept, &local_lower, &local_upper);
+  query_compound(c, local_lower, local_upper, visit);
+}
+
+// calls visit(child_a, child_b) for the parts of a and b that may come within margin at the start
+// of the step, or at any time during it when swept. the parts of the body with fewer of them are
+// looked up in the hierarchy of the other
+template <typename F>
+static void overlappingParts(const world* w, int ia, const body* a, int ib, const body* b,
+                             float32 margin, bool swept, F visit) {
+  bool outer_a = partCount(w, ia) < partCount(w, ib);
+  int outer = outer_a ? ia : ib;
+  int inner = outer_a ? ib : ia;
+  const body* outer_body = outer_a ? a : b;
+  const body* inner_body = outer_a ? b : a;
+  const compound* c = compoundOf(w, outer);
+  for (int i = 0; i < partCount(w, outer); i++) {
+    vec2 center = c ? c->centers[i] : vec2(float32(0), float32(0));
+    float32 extent = (c ? c->radii[i] : shapeOf(w, outer)->radius) + margin;
+    vec2 lower, upper;
+    partBounds(outer_body, center, extent, swept, &lower, &upper);
+    visitParts(w, inner, inner_body, lower, upper, swept, [&visit, outer_a, i](int j) {
+      if (outer_a) {
+        visit(i, j);
+      } else {
+        visit(j, i);
+      }
+    });
+  }
+}
+
+// calls emit with the manifold of every pair of parts of a and b within margin, posed as given,
+// with the children in the keys
+template <typename F>
+static void bodyManifolds(const world* w, int ia, const body* a, int ib, const body* b,
+                          float32 margin, F emit) {
+  if (!compoundOf(w, ia) && !compoundOf(w, ib)) {
+    manifold m;
+    if (polygon_manifold(a, shapeOf(w, ia), b, shapeOf(w, ib), margin, float32(0), &m)) {
+      emit(m);
+    }
+    return;
+  }
+  overlappingParts(w, ia, a, ib, b, margin, false, [w, ia, a, ib, b, margin, &emit](int i, int j) {
+    manifold m;
+    if (!polygon_manifold(a, partShape(w, ia, i), b, partShape(w, ib, j), margin, float32(0),
+                          &m)) {
+      return;
+    }
+    for (int k = 0; k < m.point_count; k++) {
+      m.points[k].key |= child_key(i, j);
+    }
+    emit(m);
+  });
+}
+
+// heightfield cells are built when they are needed so height edits take effect right away
+static chain_edge terrainEdge(const world* w, int edge) {
+  int chain_edges = (int)w->terrain.edges.size();
+  return edge < chain_edges ? w->terrain.edges[edge]
+                            : heightfield_edge(&w->field, edge - chain_edges);
+}
+
+static contact_constraint makeContact(int ia, const body* a, int ib, const body* b,
+                                      const manifold& m) {
+  contact_constraint c;
+  c.index_a = ia;
+  c.index_b = ib;
+  c.normal = m.normal;
+  c.friction = sqrt(a->friction * b->friction);
+  c.point_count = m.point_count;
+  for (int j = 0; j < m.point_count; j++) {
+    contact_point_constraint* cp = c.points + j;
+    cp->ra = m.points[j].point - a->center;
+    cp->rb = m.points[j].point - b->center;
+    cp->separation = m.points[j].separation;
+    cp->key = m.points[j].key;
+  }
+  return c;
+}
+
+static bool pairBefore(const contact_constraint& p, const contact_constraint& q) {
+  return p.index_a < q.index_a || (p.index_a == q.index_a && p.index_b < q.index_b);
+}
+
+// static and kinematic bodies go with whatever they meet
+static ccd_mode pairMode(const body* a, const body* b) {
+  ccd_mode mode = is_dynamic(a) ? a->ccd : CCD_OFF;
+  return is_dynamic(b) && b->ccd > mode ? b->ccd : mode;
+}
+
+// speculative pairs get contacts out to the distance they can close during the step and the
+// solver keeps them from closing more than the gap. no point of a body moves further than its
+// velocity plus the arc its rotation sweeps at the shape radius
+static float32 pairMargin(const world* w, int ia, const body* a, int ib, const body* b,
+                          ccd_mode mode) {
+  float32 margin = w->params.contact_margin;
+  if (mode != CCD_SPECULATIVE) {
+    return margin;
+  }
+  margin = margin + magnitude(b->vel - a->vel);
+  const shape* sa = shapeOf(w, ia);
+  const shape* sb = shapeOf(w, ib);
+  if (sa) {
+    margin = margin + abs(a->w) * sa->radius;
+  }
+  if (sb) {
+    margin = margin + abs(b->w) * sb->radius;
+  }
+  return margin;
+}
+
+// calls emit with the manifold of every part of the body within margin of a terrain edge, with the
+// normal from a to b. edge manifolds only use bits 8 to 11 of their keys, the low 12 bits of the
+// edge go above them and the next 8 below them so the contacts of a body with the edges of a long
+// chain, which all share a pair, don't share keys, and the child goes in the top byte
+template <typename F>
+static void terrainManifolds(const world* w, int ia, const body* a, int ib, const body* b,
+                             int edge, float32 margin, F emit) {
+  bool terrain_a = ia == w->terrain_body;
+  int index = terrain_a ? ib : ia;
+  const body* other = terrain_a ? b : a;
+  chain_edge e = terrainEdge(w, edge);
+  vec2 lower(min(e.v0.x, e.v1.x) - margin, min(e.v0.y, e.v1.y) - margin);
+  vec2 upper(max(e.v0.x, e.v1.x) + margin, max(e.v0.y, e.v1.y) + margin);
+  visitParts(w, index, other, lower, upper, false,
+             [w, index, other, &e, margin, edge, terrain_a, &emit](int child) {
+               manifold m;
+               if (!edge_manifold(&e, other, partShape(w, index, child), margin, float32(0),
+                                  &m)) {
+                 return;
+               }
+               assert(edge < TERRAIN_MAX_EDGES);
+               uint32_t key = (uint32_t)(edge & 0xfff) << 12 | (uint32_t)edge >> 12 |
+                              (terrain_a ? child_key(0, child) : child_key(child, 0));
+               for (int j = 0; j < m.point_count; j++) {
+                 m.points[j].key |= key;
+               }
+               if (!terrain_a) {
+                 m.normal = -m.normal;
+               }
+               emit(m);
+             });
+}
+
+// terrain contacts come out in pair order: bodies before the terrain body are index_a of their
+// pairs and the ones after it index_b. they are merged into the body contacts from the back
+static void collideTerrain(world* w) {
+  int count = (int)w->terrain_pairs.size();
+  // every part of a body can touch the edge
+  int capacity = 0;
+  for (int i = 0; i < count; i++) {
+    capacity += partCount(w, w->terrain_pairs[i].index);
+  }
+  contact_constraint* found = arena_array<contact_constraint>(&w->scratch, capacity);
+  int found_count = 0;
+  for (int i = 0; i < count; i++) {
+    const terrain_pair* p = &w->terrain_pairs[i];
+    int ia = std::min(p->index, w->terrain_body);
+    int ib = std::max(p->index, w->terrain_body);
+    const body* a = &w->bodies[ia];
+    const body* b = &w->bodies[ib];
+
+    int before = found_count;
+    ccd_mode mode = pairMode(a, b);
+    terrainManifolds(w, ia, a, ib, b, p->edge, pairMargin(w, ia, a, ib, b, mode),
+                     [found, &found_count, ia, a, ib, b](const manifold& m) {
+                       found[found_count++] = makeContact(ia, a, ib, b, m);
+                     });
+    if (found_count == before && mode == CCD_FULL) {
+      toi_pair tp = {};
+      tp.index_a = ia;
+      tp.index_b = ib;
+      tp.edge = p->edge;
+      w->toi_pairs[w->toi_pair_count++] = tp;
+    }
+  }
+
+  std::vector<contact_constraint>& contacts = w->contacts;
+  int i = (int)contacts.size() - 1;
+  int j = found_count - 1;
+  contacts.resize(contacts.size() + found_count);
+  for (int k = (int)contacts.size() - 1; j >= 0; k--) {
+    if (i >= 0 && pairBefore(found[j], contacts[i])) {
+      contacts[k] = contacts[i--];
+    } else {
+      contacts[k] = found[j--];
+    }
+  }
+}
+
+// touching pairs become contact constraints, the rest are left for time of impact unless their
+// bodies don't ask for it
+static void collide(world* w) {
+  w->contacts.clear();
+  // at most every pair that doesn't touch becomes a time of impact pair
+  size_t pair_count = w->pairs.size() + w->terrain_pairs.size();
+  w->toi_pairs = (toi_pair*)arena_alloc(&w->scratch, pair_count * sizeof(toi_pair),
+                                        alignof(toi_pair));
+  w->toi_pair_count = 0;
+  for (size_t i = 0; i < w->pairs.size(); i++) {
+    int ia = w->pairs[i].index_a;
+    int ib = w->pairs[i].index_b;
+    const body* a = &w->bodies[ia];
+    const body* b = &w->bodies[ib];
+
+    size_t before = w->contacts.size();
+    std::vector<contact_constraint>* contacts = &w->contacts;
+    ccd_mode mode = pairMode(a, b);
+    bodyManifolds(w, ia, a, ib, b, pairMargin(w, ia, a, ib, b, mode),
+                  [contacts, ia, a, ib, b](const manifold& m) {
+                    contacts->push_back(makeContact(ia, a, ib, b, m));
+                  });
+    if (w->contacts.size() == before && mode == CCD_FULL) {
+      toi_pair tp = {};
+      tp.index_a = ia;
+      tp.index_b = ib;
+      tp.edge = -1;
+      w->toi_pairs[w->toi_pair_count++] = tp;
+    }
+  }
+  collideTerrain(w);
+}
+
+static bool bodiesOverlap(const world* w, int ia, const body* a, int ib, const body* b) {
+  if (!compoundOf(w, ia) && !compoundOf(w, ib)) {
+    return shapes_overlap(a, shapeOf(w, ia), b, shapeOf(w, ib));
+  }
+  bool overlap = false;
+  overlappingParts(w, ia, a, ib, b, float32(0), false,
+                   [w, ia, a, ib, b, &overlap](int i, int j) {
+                     overlap = overlap || shapes_overlap(a, partShape(w, ia, i), b,
+                                                         partShape(w, ib, j));
+                   });
+  return overlap;
+}
+
+static void addOverlapEvent(world* w, const body_pair& p, overlap_event_type type) {
+  bool sensor_a = w->bodies[p.index_a].sensor;
+  overlap_event e;
+  e.sensor = sensor_a ? p.index_a : p.index_b;
+  e.other = sensor_a ? p.index_b : p.index_a;
+  e.type = type;
+  w->overlap_events.push_back(e);
+}
+
+// sensor pairs whose shapes overlap at the start of the step, merged with the last step's overlaps
+// to find the pairs that began or stopped overlapping
+static void senseOverlaps(world* w) {
+  w->previous_overlaps.swap(w->overlaps);
+  w->overlaps.clear();
+  for (size_t i = 0; i < w->sensor_pairs.size(); i++) {
+    int ia = w->sensor_pairs[i].index_a;
+    int ib = w->sensor_pairs[i].index_b;
+    if (bodiesOverlap(w, ia, &w->bodies[ia], ib, &w->bodies[ib])) {
+      w->overlaps.push_back(w->sensor_pairs[i]);
+    }
+  }
+
+  w->overlap_events.clear();
+  const std::vector<body_pair>& old = w->previous_overlaps;
+  const std::vector<body_pair>& now = w->overlaps;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < old.size() || j < now.size()) {
+    if (j == now.size() || (i < old.size() && bodyPairBefore(old[i], now[j]))) {
+      addOverlapEvent(w, old[i++], OVERLAP_END);
+    } else if (i == old.size() || bodyPairBefore(now[j], old[i])) {
+      addOverlapEvent(w, now[j++], OVERLAP_BEGIN);
+    } else {
+      i++;
+      j++;
+    }
+  }
+}
+
+// carry accumulated impulses over from last step's contacts with matching pair and point keys,
+// both lists are in pair order so a single merge pass is enough. a body has a contact per terrain
+// edge it touches and compounds one per touching pair of children, all with the same pair, so
+// every old contact of the pair is searched
+static void matchContacts(world* w) {
+  const std::vector<contact_constraint>& old = w->previous_contacts;
+  size_t k = 0;
+  for (size_t i = 0; i < w->contacts.size(); i++) {
+    contact_constraint* c = &w->contacts[i];
+    while (k < old.size() && pairBefore(old[k], *c)) {
+      k++;
+    }
+    for (size_t o = k; o < old.size() && !pairBefore(*c, old[o]); o++) {
+      for (int j = 0; j < c->point_count; j++) {
+        for (int l = 0; l < old[o].point_count; l++) {
+          if (old[o].points[l].key == c->points[j].key) {
+            c->points[j].normal_impulse = old[o].points[l].normal_impulse;
+            c->points[j].tangent_impulse = old[o].points[l].tangent_impulse;
+            break;
+          }
+        }
+      }
+    }
+  }
+}
+
+// the earliest impact of any part of the bodies whose swept bounds overlap
+static void sweepParts(world* w, toi_pair* tp, float32 start_time) {
+  tp->hit = false;
+  float32 margin = w->params.contact_margin;
+  rotation_sampling rotation = w->params.toi_rotation;
+  if (tp->edge >= 0) {
+    int index = tp->index_a == w->terrain_body ? tp->index_b : tp->index_a;
+    const body* b = &w->bodies[index];
+    chain_edge e = terrainEdge(w, tp->edge);
+    vec2 lower(min(e.v0.x, e.v1.x) - margin, min(e.v0.y, e.v1.y) - margin);
+    vec2 upper(max(e.v0.x, e.v1.x) + margin, max(e.v0.y, e.v1.y) + margin);
+    visitParts(w, index, b, lower, upper, true,
+               [w, tp, index, b, &e, margin, start_time, rotation](int i) {
+                 float32 time;
+                 vec2 impact;
+                 if (edge_collision(&e, b, partShape(w, index, i), margin, &time, &impact,
+                                    start_time, rotation) &&
+                     (!tp->hit || time < tp->time)) {
+                   tp->hit = true;
+                   tp->time = time;
+                   tp->impact = impact;
+                   tp->child_a = tp->index_a == index ? i : 0;
+                   tp->child_b = tp->index_b == index ? i : 0;
+                 }
+               });
+    return;
+  }
+  const body* a = &w->bodies[tp->index_a];
+  const body* b = &w->bodies[tp->index_b];
+  overlappingParts(w, tp->index_a, a, tp->index_b, b, margin, true,
+                   [w, tp, a, b, start_time, rotation](int i, int j) {
+                     float32 time;
+                     feature fa, fb;
+                     vec2 impact;
+                     if (continuous_collision(a, partShape(w, tp->index_a, i), b,
+                                              partShape(w, tp->index_b, j), &time, &fa, &fb,
+                                              &impact, start_time, rotation) &&
+                         (!tp->hit || time < tp->time)) {
+                       tp->hit = true;
+                       tp->time = time;
+                       tp->fa = fa;
+                       tp->fb = fb;
+                       tp->impact = impact;
+                       tp->child_a = i;
+                       tp->child_b = j;
+                     }
+                   });
+}
+
+static void sweep(world* w, toi_pair* tp, float32 start_time) {
+  if (compoundOf(w, tp->index_a) || compoundOf(w, tp->index_b)) {
+    sweepParts(w, tp, start_time);
+    return;
+  }
+  if (tp->edge >= 0) {
+    int index = tp->index_a == w->terrain_body ? tp->index_b : tp->index_a;
+    chain_edge e = terrainEdge(w, tp->edge);
+    tp->hit = edge_collision(&e, &w->bodies[index], shapeOf(w, index), w->params.contact_margin,
+                             &tp->time, &tp->impact, start_time, w->params.toi_rotation);
+    return;
+  }
+  tp->hit = continuous_collision(&w->bodies[tp->index_a], shapeOf(w, tp->index_a),
+                                 &w->bodies[tp->index_b], shapeOf(w, tp->index_b), &tp->time,
+                                 &tp->fa, &tp->fb, &tp->impact, start_time,
+                                 w->params.toi_rotation);
+}
+
+static stopped_body* findStopped(world* w, int index) {
+  for (int i = 0; i < w->stopped_count; i++) {
+    if (w->stopped[i].index == index) {
+      return &w->stopped[i];
+    }
+  }
+  return nullptr;
+}
+
+// the contact manifold at the impact pose is solved for the two bodies alone, falling back to the
+// single impact point if no manifold is found, terrain impacts always have one. dynamic bodies
+// then stay at their impact pose for the rest of the step since an impulse alone doesn't keep a
+// spinning body out of the surface
+static void solveImpact(world* w, const toi_pair* tp) {
+  int indices[2] = {tp->index_a, tp->index_b};
+  // copies at the impact pose moving with their real velocities
+  body pair[2] = {w->bodies[tp->index_a], w->bodies[tp->index_b]};
+  for (int k = 0; k < 2; k++) {
+    body* b = pair + k;
+    b->center = get_center(b, tp->time);
+    b->r = b->r + tp->time * b->w;
+    stopped_body* s = findStopped(w, indices[k]);
+    if (s) {
+      b->vel = s->vel;
+      b->w = s->w;
+    }
+  }
+
+  contact_constraint c;
+  contact_constraint* contacts = &c;
+  int contact_count = 0;
+  float32 margin = w->params.contact_margin;
+  if (tp->edge < 0) {
+    // compounds can touch with several pairs of children at once
+    int capacity = 0;
+    if (compoundOf(w, tp->index_a) || compoundOf(w, tp->index_b)) {
+      overlappingParts(w, tp->index_a, pair, tp->index_b, pair + 1, margin, false,
+                       [&capacity](int, int) { capacity++; });
+      contacts = arena_array<contact_constraint>(&w->scratch, capacity);
+    }
+    bodyManifolds(w, tp->index_a, pair, tp->index_b, pair + 1, margin,
+                  [contacts, &contact_count, &pair](const manifold& m) {
+                    contacts[contact_count++] = makeContact(0, pair, 1, pair + 1, m);
+                  });
+  } else {
+    // a body landing on the terrain usually touches several edges at once, they are all solved
+    // together so the impulse isn't applied at the edge that happened to be hit first
+    int index = tp->index_a == w->terrain_body ? tp->index_b : tp->index_a;
+    terrain_pair key;
+    key.index = index;
+    std::pair<std::vector<terrain_pair>::const_iterator, std::vector<terrain_pair>::const_iterator>
+        range = std::equal_range(w->terrain_pairs.begin(), w->terrain_pairs.end(), key,
+                                 [](const terrain_pair& p, const terrain_pair& q) {
+                                   return p.index < q.index;
+                                 });
+    int capacity = (int)(range.second - range.first) * partCount(w, index);
+    contacts = arena_array<contact_constraint>(&w->scratch, capacity);
+    for (std::vector<terrain_pair>::const_iterator it = range.first; it != range.second; ++it) {
+      terrainManifolds(w, tp->index_a, pair, tp->index_b, pair + 1, it->edge, margin,
+                       [contacts, &contact_count, &pair](const manifold& m) {
+                         contacts[contact_count++] = makeContact(0, pair, 1, pair + 1, m);
+                       });
+    }
+  }
+
+  if (contact_count > 0) {
+    prepare_contacts(pair, contacts, contact_count, float32(0), w->params.linear_slop,
+                     w->params.restitution);
+    for (int i = 0; i < w->params.velocity_iterations; i++) {
+      for (int j = 0; j < contact_count; j++) {
+        solve_contact(pair, contacts + j);
+      }
+    }
+  } else if (tp->edge < 0) {
+    handle_collision(pair, partShape(w, tp->index_a, tp->child_a), pair + 1,
+                     partShape(w, tp->index_b, tp->child_b), tp->fa, tp->fb, tp->impact,
+                     float32(0), w->params.restitution);
+  }
+
+  for (int k = 0; k < 2; k++) {
+    body* b = &w->bodies[indices[k]];
+    if (!is_dynamic(b)) {
+      continue;
+    }
+    stopped_body* s = findStopped(w, indices[k]);
+    if (!s) {
+      stopped_body sb;
+      sb.index = indices[k];
+      s = &w->stopped[w->stopped_count++];
+      *s = sb;
+    }
+    s->vel = pair[k].vel;
+    s->w = pair[k].w;
+    b->center = pair[k].center;
+    b->r = pair[k].r;
+    b->vel = vec2(float32(0), float32(0));
+    b->w = float32(0);
+  }
+}
+
+static void restoreStopped(world* w) {
+  for (int i = 0; i < w->stopped_count; i++) {
+    body* b = &w->bodies[w->stopped[i].index];
+    b->vel = w->stopped[i].vel;
+    b->w = w->stopped[i].w;
+  }
+  w->stopped_count = 0;
+}
+
+// handle the earliest impact first, then re-sweep the pairs of the two bodies it changed. the
+// terrain body never moves, pairs that only share it with the impact keep their sweeps
+static void solveTimeOfImpact(world* w) {
+  int count = w->toi_pair_count;
+  // every event stops at most two bodies
+  w->stopped = (stopped_body*)arena_alloc(
+      &w->scratch, 2 * std::max(w->params.max_toi_events, 0) * sizeof(stopped_body),
+      alignof(stopped_body));
+  w->stopped_count = 0;
+  for (int i = 0; i < count; i++) {
+    sweep(w, &w->toi_pairs[i], float32(0));
+  }
+
+  w->toi_events = 0;
+  for (int event = 0; event < w->params.max_toi_events; event++) {
+    toi_pair* first = nullptr;
+    for (int i = 0; i < count; i++) {
+      toi_pair* tp = &w->toi_pairs[i];
+      if (tp->hit && !tp->done && (!first || tp->time < first->time)) {
+        first = tp;
+      }
+    }
+    if (!first) {
+      break;
+    }
+
+    solveImpact(w, first);
+    first->done = true;
+    w->toi_events++;
+
+    int moved_a = first->index_a == w->terrain_body ? -1 : first->index_a;
+    int moved_b = first->index_b == w->terrain_body ? -1 : first->index_b;
+    for (int i = 0; i < count; i++) {
+      toi_pair* tp = &w->toi_pairs[i];
+      if (tp->done) {
+        continue;
+      }
+      if (tp->index_a == moved_a || tp->index_a == moved_b || tp->index_b == moved_a ||
+          tp->index_b == moved_b) {
+        sweep(w, tp, first->time);
+      }
+    }
+  }
+}
+
+static void integratePositions(world* w) {
+  for (size_t i = 0; i < w->bodies.size(); i++) {
+    body* b = &w->bodies[i];
+    b->center += b->vel;
+    b->r += b->w;
+  }
+}
+
+static void saveMotion(world* w) {
+  int count = (int)w->bodies.size();
+  w->motion = arena_array<body_motion>(&w->scratch, count);
+  for (int i = 0; i < count; i++) {
+    const body* b = &w->bodies[i];
+    w->motion[i].center = b->center;
+    w->motion[i].vel = b->vel;
+    w->motion[i].r = b->r;
+    w->motion[i].w = b->w;
+  }
+}
+
+static bool sameBits(float32 a, float32 b) {
+  return a.v.v == b.v.v;
+}
+
+// bodies at rest, static or not, keep every bit of their state and stay out of the change log
+static void markMoved(world* w) {
+  for (int i = 0; i < (int)w->bodies.size(); i++) {
+    const body* b = &w->bodies[i];
+    const body_motion* m = &w->motion[i];
+    if (!sameBits(b->center.x, m->center.x) || !sameBits(b->center.y, m->center.y) ||
+        !sameBits(b->vel.x, m->vel.x) || !sameBits(b->vel.y, m->vel.y) || !sameBits(b->r, m->r) ||
+        !sameBits(b->w, m->w)) {
+      mark_body_changed(w, i);
+    }
+  }
+}
+
+typedef std::chrono::steady_clock step_clock;
+
+// milliseconds since start, start is moved to now
+static double lap(step_clock::time_point* start) {
+  step_clock::time_point now = step_clock::now();
+  double ms = std::chrono::duration<double, std::milli>(now - *start).count();
+  *start = now;
+  return ms;
+}
+
+static void reserveStepMemory(world* w) {
+  const world_params& p = w->params;
+  if (!w->scratch.base && w->scratch.capacity < p.scratch_capacity) {
+    w->scratch.capacity = p.scratch_capacity;
+  }
+  if ((int)w->pairs.capacity() < p.pair_capacity) {
+    w->pairs.reserve(p.pair_capacity);
+  }
+  if ((int)w->terrain_pairs.capacity() < p.terrain_pair_capacity) {
+    w->terrain_pairs.reserve(p.terrain_pair_capacity);
+  }
+  if ((int)w->contacts.capacity() < p.contact_capacity) {
+    w->contacts.reserve(p.contact_capacity);
+    w->previous_contacts.reserve(p.contact_capacity);
+    w->graph.order.reserve(p.contact_capacity);
+    w->graph.colors.reserve(p.contact_capacity);
+  }
+  if ((int)w->sensor_pairs.capacity() < p.sensor_pair_capacity) {
+    w->sensor_pairs.reserve(p.sensor_pair_capacity);
+    w->overlaps.reserve(p.sensor_pair_capacity);
+    w->previous_overlaps.reserve(p.sensor_pair_capacity);
+    // every pair that overlapped in either step can have an event
+    w->overlap_events.reserve(2 * p.sensor_pair_capacity);
+  }
+}
+
+static void updateStepMemory(world* w) {
+  step_memory* m = &w->memory;
+  m->max_pairs = std::max(m->max_pairs, (int)w->pairs.size());
+  m->max_contacts = std::max(m->max_contacts, (int)w->contacts.size());
+  m->max_toi_pairs = std::max(m->max_toi_pairs, w->toi_pair_count);
+  m->max_terrain_pairs = std::max(m->max_terrain_pairs, (int)w->terrain_pairs.size());
+  m->max_sensor_pairs = std::max(m->max_sensor_pairs, (int)w->sensor_pairs.size());
+  m->scratch_high_water = w->scratch.high_water;
+  m->scratch_grows = w->scratch.grows;
+}
+
+void step_world(world* w) {
+  collision_diagnostics* previous_diagnostics = set_collision_diagnostics(w->diagnostics);
+  step_clock::time_point start = step_clock::now();
+
+  reserveStepMemory(w);
+  reset_arena(&w->scratch);
+  saveMotion(w);
+
+  applyGravity(w);
+  findPairs(w);
+  wakeFrozen(w);
+  findTerrainPairs(w);
+  w->timings.broadphase = lap(&start);
+
+  w->previous_contacts.swap(w->contacts);
+  collide(w);
+  matchContacts(w);
+  senseOverlaps(w);
+  w->timings.narrowphase = lap(&start);
+
+  body* bodies = w->bodies.data();
+  int contact_count = (int)w->contacts.size();
+  prepare_contacts(bodies, w->contacts.data(), contact_count, w->params.baumgarte,
+                   w->params.linear_slop, w->params.restitution);
+  color_constraints(&w->graph, bodies, (int)w->bodies.size(), w->contacts.data(), contact_count);
+  solve_contacts(bodies, w->contacts.data(), &w->graph, w->params.velocity_iterations, w->pool);
+  w->timings.solve = lap(&start);
+
+  solveTimeOfImpact(w);
+  w->timings.toi = lap(&start);
+
+  integratePositions(w);
+  restoreStopped(w);
+  markMoved(w);
+  updateStepMemory(w);
+  w->timings.integrate = lap(&start);
+  set_collision_diagnostics(previous_diagnostics);
+}
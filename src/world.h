@@ -0,0 +1,222 @@
+#ifndef WORLD_H
+#define WORLD_H
+#include <vector>
+#include "arena.h"
+#include "collision.h"
+#include "solver.h"
+#include "terrain.h"
+
+struct thread_pool;
+struct world;
+
+// identifies one world and one line of its history, drawn from a counter shared by every world.
+// construction, copies and mark_all_changed take a new one, so a state hash is never brought up to
+// date from a log it didn't follow, even for a world reallocated at the same address
+uint64_t next_world_generation();
+
+struct world_generation {
+  uint64_t value = next_world_generation();
+  world_generation() {}
+  world_generation(const world_generation&) {}
+  world_generation& operator=(const world_generation&) {
+    value = next_world_generation();
+    return *this;
+  }
+};
+
+// return false to drop the pair of bodies index_a < index_b before the narrowphase
+typedef bool (*pair_filter)(const world* w, int index_a, int index_b, void* user);
+
+// all quantities are per step, like the collision functions a body moves by vel and rotates by w
+// over one step parameterized by t in [0, 1]
+struct world_params {
+  vec2 gravity = {float32(0), float32(0)};  // velocity change per step
+  int velocity_iterations = 8;
+  float32 contact_margin = float32(0.05f);  // polygons closer than this get contact constraints
+  float32 baumgarte = float32(0.2f);        // fraction of penetration removed per step
+  float32 linear_slop = float32(0.005f);    // penetration allowed without correction
+  float32 restitution = float32(0);
+  int max_toi_events = 32;  // time of impact collisions handled per step
+  rotation_sampling toi_rotation = ROTATION_EXACT;  // how time of impact sweeps rotate bodies
+
+  // memory reserved before the first step. everything grows on demand past these, they only
+  // move the allocations of the first steps up front
+  size_t scratch_capacity = 0;  // bytes of per step scratch
+  int pair_capacity = 0;
+  int contact_capacity = 0;
+  int terrain_pair_capacity = 0;
+  int sensor_pair_capacity = 0;
+};
+
+struct body_pair {
+  int index_a, index_b;  // index_a < index_b
+};
+
+enum overlap_event_type {
+  OVERLAP_BEGIN,
+  OVERLAP_END,
+};
+
+// a sensor started or stopped overlapping another body
+struct overlap_event {
+  int sensor;
+  int other;
+  overlap_event_type type;
+};
+
+// dynamic body whose swept bounds overlap a terrain edge. edges are numbered with the chain edges
+// first and the heightfield cells after them
+struct terrain_pair {
+  int index;
+  int edge;
+};
+
+// pair that was not touching at the start of the step and is swept with continuous_collision
+struct toi_pair {
+  int index_a, index_b;
+  int edge;  // terrain edge swept against the other body if one of them is the terrain body, or -1
+  int child_a, child_b;  // children of compound bodies that were hit, 0 for other bodies
+  bool hit, done;
+  float32 time;
+  feature fa, fb;
+  vec2 impact;
+};
+
+// dynamic body held at its time of impact pose for the rest of the step
+struct stopped_body {
+  int index;
+  vec2 vel;  // velocity restored once the step is done
+  float32 w;
+};
+
+// state of a body at the start of the step, the bodies it differs from afterwards are marked
+// changed
+struct body_motion {
+  vec2 center, vel;
+  float32 r, w;
+};
+
+// largest per step usage since the world was created, to size world_params capacities
+struct step_memory {
+  int max_pairs = 0;
+  int max_contacts = 0;
+  int max_toi_pairs = 0;
+  int max_terrain_pairs = 0;
+  int max_sensor_pairs = 0;
+  size_t scratch_high_water = 0;  // bytes
+  int scratch_grows = 0;          // times the scratch block was allocated
+};
+
+// milliseconds spent in each stage of the last step
+struct step_timings {
+  double broadphase = 0;
+  double narrowphase = 0;
+  double solve = 0;
+  double toi = 0;
+  double integrate = 0;
+};
+
+struct world {
+  std::vector<body> bodies;
+  shape_registry shapes;  // shapes referenced by the bodies
+  world_params params;
+  thread_pool* pool = nullptr;  // optional, solves constraint colors in parallel
+  collision_diagnostics* diagnostics = nullptr;  // optional, receives diagnostics during steps
+  // optional, called for the pairs the body filters let through. pairs with the terrain body are
+  // filtered once per body instead of once per edge
+  pair_filter filter = nullptr;
+  void* filter_user = nullptr;
+  step_timings timings;
+  step_memory memory;
+  int toi_events = 0;  // time of impact collisions handled in the last step
+
+  // optional, nonzero for bodies left out of the step. a frozen body is woken as soon as the
+  // broadphase pairs it with a simulated dynamic body, otherwise it only integrates its velocity
+  // and pairs between frozen or static bodies are dropped. rollback uses this to skip bodies
+  // whose recorded state is still valid
+  std::vector<uint8_t> frozen;
+
+  // static level geometry, bodies collide with its edges and the heightfield through the terrain
+  // body which has no shape and never collides with other bodies. see finish_terrain
+  chain_terrain terrain;
+  heightfield field;
+  int terrain_body = -1;
+
+  // step data, kept around so memory is reused and contacts can be warm started. the vectors only
+  // grow, so once they reach the high water mark of a scene stepping stops allocating
+  std::vector<body_pair> pairs;
+  std::vector<terrain_pair> terrain_pairs;
+  std::vector<contact_constraint> contacts;
+  std::vector<contact_constraint> previous_contacts;
+  constraint_graph graph;
+
+  // pairs with a sensor are kept apart from the others and never get contacts. overlaps are the
+  // sensor pairs whose shapes overlapped at the start of the last step, and overlap_events the
+  // pairs that entered or left that set, in pair order with at most one event per pair. snapshots
+  // save the overlaps, so the events after a restore continue from the restored step
+  std::vector<body_pair> sensor_pairs;
+  std::vector<body_pair> overlaps;
+  std::vector<body_pair> previous_overlaps;
+  std::vector<overlap_event> overlap_events;
+
+  // bodies whose state may have changed, so update_state_hash only rehashes those. step_world
+  // adds the bodies whose state bits differ from the start of the step, apply_input and the
+  // snapshot restores add theirs, code that writes body state directly has to call
+  // mark_body_changed. the log keeps the latest entries only, changed_base is the position of the
+  // first one since the world was created, hashes behind it rehash every body. mark_all_changed
+  // starts over under a new generation. heights_version counts the edits of the heightfield
+  std::vector<int> changed_bodies;
+  size_t changed_base = 0;
+  world_generation generation;
+  uint32_t heights_version = 0;
+
+  // data that doesn't outlive the step, allocated from scratch which is reset at the start of
+  // every step
+  arena scratch;
+  vec2* bounds = nullptr;  // lower and upper corner of the swept bounds of each body
+  int* proxies = nullptr;  // body indices sorted along x
+  toi_pair* toi_pairs = nullptr;
+  int toi_pair_count = 0;
+  stopped_body* stopped = nullptr;
+  int stopped_count = 0;
+  body_motion* motion = nullptr;  // one per body
+};
+
+// velocity change applied to a body at the start of a frame, before the step
+struct body_input {
+  int frame;
+  int body;
+  vec2 impulse;
+  float32 angular_impulse;
+};
+
+// returns the index of the new body, b.shape_id must come from add_shape on w->shapes
+int add_body(world* w, const body& b);
+
+// inv_mass and inv_I from the area and moment of shape s at density, 0 makes b static
+void set_body_mass(body* b, const shape* s, float32 density);
+
+void apply_input(world* w, const body_input& input);
+
+// records that the state of a body may have changed for update_state_hash
+void mark_body_changed(world* w, int index);
+
+// every body may have changed, for example after a restore
+void mark_all_changed(world* w);
+
+// call after storing into w->field.heights so state hashes and rollback history pick up the edit
+void mark_heights_changed(world* w);
+
+// builds the hierarchy of w->terrain once its chains are added, adding the terrain body on the
+// first call. a world with only a heightfield needs it for the terrain body too. every edge and
+// cell uses friction. returns the index of the terrain body, or -1 and changes nothing if w->field
+// has heights but fewer than 2 of them or a spacing that isn't positive, or if the edges and cells
+// together are more than TERRAIN_MAX_EDGES
+int finish_terrain(world* w, float32 friction);
+
+// advance the world by one step:
+// gravity, broadphase, contact manifolds and sensor overlaps, colored constraint solve, time of
+// impact, integration
+void step_world(world* w);
+
+#endif  // WORLD_H
@@ -0,0 +1,60 @@
+#include "world_batch.h"
+#include <algorithm>
+#include <chrono>
+#include "thread_pool.h"
+
+int add_world(world_batch* batch, world* w) {
+  batch->worlds.push_back(w);
+  batch->stats.push_back(batch_world_stats());
+  return (int)batch->worlds.size() - 1;
+}
+
+static void stepOne(world_batch* batch, int index) {
+  world* w = batch->worlds[index];
+  // the pool is busy with the batch, the solver gives the same results without it
+  thread_pool* pool = w->pool;
+  w->pool = nullptr;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  step_world(w);
+  double ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  w->pool = pool;
+
+  batch_world_stats* s = &batch->stats[index];
+  s->last_ms = ms;
+  s->mean_ms = s->steps ? s->mean_ms + (ms - s->mean_ms) / 16 : ms;
+  s->max_ms = std::max(s->max_ms, ms);
+  s->steps++;
+}
+
+static void stepGroup(int group, void* context) {
+  world_batch* batch = (world_batch*)context;
+  int begin = group * batch->group_size;
+  int end = std::min(begin + batch->group_size, (int)batch->order.size());
+  for (int i = begin; i < end; i++) {
+    stepOne(batch, batch->order[i]);
+  }
+}
+
+void step_batch(world_batch* batch) {
+  int count = (int)batch->worlds.size();
+  batch->order.resize(count);
+  for (int i = 0; i < count; i++) {
+    batch->order[i] = i;
+  }
+  const std::vector<batch_world_stats>& stats = batch->stats;
+  std::stable_sort(batch->order.begin(), batch->order.end(),
+                   [&stats](int a, int b) { return stats[a].mean_ms > stats[b].mean_ms; });
+
+  if (batch->group_size < 1) {
+    batch->group_size = 1;
+  }
+  int groups = (count + batch->group_size - 1) / batch->group_size;
+  if (batch->pool) {
+    batch->pool->parallel_for(groups, stepGroup, batch);
+  } else {
+    for (int i = 0; i < groups; i++) {
+      stepGroup(i, batch);
+    }
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef WORLD_BATCH_H
+#define WORLD_BATCH_H
+#include <stdint.h>
+#include <vector>
+#include "world.h"
+
+struct thread_pool;
+
+// steps many independent worlds per tick on a shared thread pool. every world is stepped start to
+// finish by a single thread, so its results don't depend on the pool or on the other worlds. each
+// world keeps its own step buffers between ticks, nothing is shared between worlds
+
+struct batch_world_stats {
+  double last_ms = 0;
+  double mean_ms = 0;  // exponential moving average over the recent steps
+  double max_ms = 0;
+  uint64_t steps = 0;
+};
+
+struct world_batch {
+  thread_pool* pool = nullptr;  // optional, worlds are stepped in order on the caller without it
+  int group_size = 4;           // worlds a worker steps back to back before claiming more
+  std::vector<world*> worlds;
+  std::vector<batch_world_stats> stats;  // parallel to worlds
+
+  std::vector<int> order;  // world indices from the most to the least expensive
+};
+
+// returns the index of the world in the batch, the batch doesn't take ownership
+int add_world(world_batch* batch, world* w);
+
+// step every world once. worlds are handed out in groups with the most expensive ones first
+// so the long steps don't end up last on an otherwise idle pool
+void step_batch(world_batch* batch);
+
+#endif  // WORLD_BATCH_H
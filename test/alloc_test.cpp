@@ -0,0 +1,89 @@
+// allocation test: every benchmark scene is stepped once to record its high water marks, then
+// again with world_params capacities set from them. after the first step of the second run no
+// step may reach the heap
+//
+// usage: jumphysics_alloc_test [--frames n]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "scenes.h"
+#include "world.h"
+
+static long allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  void* p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+static bool checkScene(const scene* s, int frames) {
+  world recorded;
+  s->build(&recorded);
+  for (int i = 0; i < frames; i++) {
+    step_world(&recorded);
+  }
+  const step_memory& m = recorded.memory;
+
+  world w;
+  s->build(&w);
+  w.params.scratch_capacity = m.scratch_high_water;
+  w.params.pair_capacity = m.max_pairs;
+  w.params.contact_capacity = m.max_contacts;
+  w.params.terrain_pair_capacity = m.max_terrain_pairs;
+  w.params.sensor_pair_capacity = m.max_sensor_pairs;
+  step_world(&w);
+  long before = allocations;
+  for (int i = 1; i < frames; i++) {
+    step_world(&w);
+  }
+  long count = allocations - before;
+
+  bool ok = count == 0 && w.memory.scratch_grows == 1;
+  printf("%-16s %s: %ld allocations, %d pairs, %d contacts, %d kB scratch, %d scratch grows\n",
+         s->name, ok ? "ok" : "FAIL", count, m.max_pairs, m.max_contacts,
+         (int)(m.scratch_high_water / 1024), w.memory.scratch_grows);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  int frames = 200;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--frames n]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  int failures = 0;
+  for (int i = 0; i < scene_count; i++) {
+    failures += !checkScene(scenes + i, frames);
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,1361 @@
+// determinism harness: hashes the results of the numeric layer, the collision kernels and every
+// benchmark scene frame by frame and compares them with the golden files checked in next to this
+// file. the goldens were recorded by one build, every other compiler, optimization level and CPU
+// has to reproduce them bit for bit
+//
+// the self-checking groups after them need no golden files: the kernel checks compare collision
+// results with values known in closed form or found by brute force, or small worlds with the
+// outcome their setup must have, the others compare two ways of reaching the same state in this
+// build, like stepping with and without threads
+//
+// usage: jumphysics_test [--golden dir] [--frames n] [--update] [--checks]
+//
+// --update rewrites the golden files from this build instead of comparing. --checks only runs the
+// self-checking groups. the trig, ccd and scene hashes depend on f32_sin and f32_cos, so their
+// goldens can only be recorded on a build with the reference trig functions. until every golden
+// file is checked in the run exits with SKIPPED, which ctest reports as not run, not as a pass
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "collision.h"
+#include "replay.h"
+#include "rollback.h"
+#include "scenes.h"
+#include "snapshot.h"
+#include "snapshot_delta.h"
+#include "state_hash.h"
+#include "thread_pool.h"
+#include "world.h"
+#include "world_batch.h"
+
+#ifndef JUMPHYSICS_GOLDEN_DIR
+#define JUMPHYSICS_GOLDEN_DIR "test/golden"
+#endif
+
+#define CASES 4096
+
+// exit code of a run that passed but had groups without a golden file, SKIP_RETURN_CODE of the
+// determinism test
+#define SKIPPED 77
+
+// one named hash per line of a golden file
+struct golden_line {
+  std::string key;
+  uint64_t hash;
+};
+
+struct hasher {
+  uint64_t h = 14695981039346656037ull;
+  void add(uint32_t word) {
+    for (int i = 0; i < 4; i++) {
+      h ^= (word >> (8 * i)) & 0xff;
+      h *= 1099511628211ull;
+    }
+  }
+  void add(float32 x) { add(x.v.v); }
+  void add(vec2 v) {
+    add(v.x);
+    add(v.y);
+  }
+  void add(const feature& f) {
+    add((uint32_t)f.index_1);
+    add((uint32_t)f.index_2);
+    add((uint32_t)f.edge);
+  }
+};
+
+struct sequence {
+  uint32_t state;
+  uint32_t next() {
+    state = state * 1664525u + 1013904223u;
+    return state;
+  }
+  // n / 64 for n in [-range, range]
+  float32 coordinate(int32_t range) {
+    int32_t n = (int32_t)((next() >> 8) % (range + 1));
+    if (next() >> 31) {
+      n = -n;
+    }
+    return float32(n) / float32(64);
+  }
+};
+
+// finite floats spread over many exponents
+static float32 randomFloat(sequence* random) {
+  uint32_t bits = random->next();
+  uint32_t exponent = 64 + (bits >> 24) % 128;
+  float32 x;
+  x.v.v = (bits & 0x807fffffu) | exponent << 23;
+  return x;
+}
+
+static void float32Lines(std::vector<golden_line>* lines) {
+  hasher add, mul, div, sqrt_, convert;
+  sequence random = {1};
+  for (int i = 0; i < CASES; i++) {
+    float32 a = randomFloat(&random);
+    float32 b = randomFloat(&random);
+    add.add(a + b);
+    mul.add(a * b);
+    div.add(a / b);
+    sqrt_.add(sqrt(abs(a)));
+    convert.add(float32((int32_t)(random.next() >> 4)));
+  }
+  lines->push_back({"add", add.h});
+  lines->push_back({"mul", mul.h});
+  lines->push_back({"div", div.h});
+  lines->push_back({"sqrt", sqrt_.h});
+  lines->push_back({"i32_to_f32", convert.h});
+}
+
+static void trigLines(std::vector<golden_line>* lines) {
+  hasher sin_, cos_, tan_, atan_, atan2_;
+  sequence random = {2};
+  for (int i = 0; i < CASES; i++) {
+    // angles within a few turns, where the simulation uses them
+    float32 a = random.coordinate(64 * 20);
+    float32 b = random.coordinate(64 * 20);
+    sin_.add(f32_sin(a));
+    cos_.add(f32_cos(a));
+    tan_.add(f32_tan(a));
+    atan_.add(f32_atan(a));
+    atan2_.add(f32_atan2(a, b));
+  }
+  lines->push_back({"sin", sin_.h});
+  lines->push_back({"cos", cos_.h});
+  lines->push_back({"tan", tan_.h});
+  lines->push_back({"atan", atan_.h});
+  lines->push_back({"atan2", atan2_.h});
+}
+
+// convex polygons with vertices on a 1/64 grid, no trigonometry involved
+static int randomPolygon(sequence* random, vec2* out) {
+  static const int32_t shapes[3][6][2] = {
+      {{-64, -64}, {64, -64}, {64, 64}, {-64, 64}},
+      {{-80, -40}, {90, -50}, {10, 70}},
+      {{-64, -32}, {0, -72}, {64, -32}, {64, 32}, {0, 72}, {-64, 32}},
+  };
+  static const int counts[3] = {4, 3, 6};
+  int shape = (int)((random->next() >> 8) % 3);
+  vec2 offset;
+  offset.x = random->coordinate(256);
+  offset.y = random->coordinate(256);
+  for (int i = 0; i < counts[shape]; i++) {
+    out[i] = offset + vec2(float32(shapes[shape][i][0]) / float32(64),
+                           float32(shapes[shape][i][1]) / float32(64));
+  }
+  return counts[shape];
+}
+
+static void gjkLines(std::vector<golden_line>* lines) {
+  hasher distance, points, features, overlaps;
+  sequence random = {3};
+  for (int i = 0; i < CASES; i++) {
+    vec2 a[MAX_VERTICES], b[MAX_VERTICES];
+    int len_a = randomPolygon(&random, a);
+    int len_b = randomPolygon(&random, b);
+    vec2 closest_a, closest_b;
+    feature fa, fb;
+    distance.add(polygon_distance(a, len_a, b, len_b, &closest_a, &closest_b, &fa, &fb));
+    points.add(closest_a);
+    points.add(closest_b);
+    features.add(fa);
+    features.add(fb);
+    float32 rounding = float32(i % 4) / float32(8);
+    overlaps.add((uint32_t)polygons_overlap(a, len_a, b, len_b, rounding));
+  }
+  lines->push_back({"distance", distance.h});
+  lines->push_back({"closest_points", points.h});
+  lines->push_back({"features", features.h});
+  lines->push_back({"overlaps", overlaps.h});
+}
+
+// point clouds on a 1/64 grid: random scatter, clouds with near duplicates and collinear runs,
+// reversed polygons for the validation
+static void shapeLines(std::vector<golden_line>* lines) {
+  hasher errors, vertices, mass;
+  sequence random = {5};
+  for (int i = 0; i < CASES / 4; i++) {
+    vec2 points[32];
+    int count = 3 + (int)((random.next() >> 8) % 30);
+    for (int k = 0; k < count; k++) {
+      int kind = (int)((random.next() >> 8) % 4);
+      if (kind == 0 && k > 0) {
+        // within a weld distance of the previous point
+        points[k] = points[k - 1] + vec2(float32(1) / float32(256), float32(0));
+      } else if (kind == 1 && k > 1) {
+        points[k] = points[k - 1] + (points[k - 1] - points[k - 2]);
+      } else {
+        points[k].x = random.coordinate(128);
+        points[k].y = random.coordinate(128);
+      }
+    }
+    shape_registry shapes;
+    int id = -1;
+    vec2 centroid(float32(0), float32(0));
+    shape_error error = make_shape(&shapes, points, count, float32(1) / float32(64), &id,
+                                   &centroid);
+    errors.add((uint32_t)error);
+    if (error == SHAPE_OK) {
+      const shape* s = get_shape(&shapes, id);
+      for (int k = 0; k < s->num_vertices; k++) {
+        vertices.add(s->vertices[k]);
+      }
+      mass.add(centroid);
+      mass.add(s->area);
+      mass.add(s->inertia);
+      // the built shape passes validation and its reversal doesn't
+      vec2 reversed[MAX_VERTICES];
+      for (int k = 0; k < s->num_vertices; k++) {
+        reversed[k] = s->vertices[s->num_vertices - 1 - k];
+      }
+      errors.add((uint32_t)validate_polygon(s->vertices, s->num_vertices));
+      errors.add((uint32_t)validate_polygon(reversed, s->num_vertices));
+    }
+  }
+  lines->push_back({"errors", errors.h});
+  lines->push_back({"vertices", vertices.h});
+  lines->push_back({"mass", mass.h});
+}
+
+// kernel checks with results known in closed form, to a tolerance since they don't need goldens
+
+static bool near(float32 a, float32 b) {
+  return abs(a - b) <= float32(1) / float32(1000);
+}
+
+static bool near(vec2 a, vec2 b) {
+  return near(a.x, b.x) && near(a.y, b.y);
+}
+
+// one contact point on the line between the cores, halfway between the surfaces
+static bool roundedContact(const shape_registry* shapes, const body* a, const body* b,
+                           vec2 normal, float32 separation, vec2 point) {
+  manifold m;
+  return polygon_manifold(a, get_shape(shapes, a->shape_id), b, get_shape(shapes, b->shape_id),
+                          float32(2), float32(0), &m) &&
+         m.point_count == 1 && near(m.normal, normal) &&
+         near(m.points[0].separation, separation) && near(m.points[0].point, point);
+}
+
+// circles and capsules collide at the distance between their cores less the radii, and a rounded
+// square has the area and polar moment of the square, four edge strips and four quarter circles
+static const char* roundedCheck(int) {
+  shape_registry shapes;
+  float32 half = float32(1) / float32(2);
+  vec2 origin(float32(0), float32(0));
+  body circle = make_circle(&shapes, origin, float32(1), float32(1));
+  body small = make_circle(&shapes, vec2(float32(3), float32(0)), half, float32(1));
+  vec2 right(float32(1), float32(0));
+  if (!roundedContact(&shapes, &circle, &small, right, float32(3) / float32(2),
+                      vec2(float32(7) / float32(4), float32(0)))) {
+    return "circle against circle";
+  }
+  body capsule = make_capsule(&shapes, origin, float32(2), half, float32(1));
+  body above = make_circle(&shapes, vec2(float32(1), float32(2)), half, float32(1));
+  if (!roundedContact(&shapes, &capsule, &above, vec2(float32(0), float32(1)), float32(1),
+                      vec2(float32(1), float32(1)))) {
+    return "capsule against circle";
+  }
+
+  vec2 square[4] = {vec2(float32(-1), float32(-1)), vec2(float32(1), float32(-1)),
+                    vec2(float32(1), float32(1)), vec2(float32(-1), float32(1))};
+  const shape* s = get_shape(&shapes, add_rounded_shape(&shapes, square, 4, half / float32(2)));
+  // 4 + 8r + pi r^2 and 8/3 + 4 (2r (4 + r^2) / 12 + 2r (1 + r / 2)^2) + pi r^2 (r^2 / 2 + 2) +
+  // 16 r^3 / 3 for r = 1/4
+  if (!near(s->area, float32(6.196350f)) || !near(s->inertia, float32(6.357168f)) ||
+      !near(s->centroid, origin)) {
+    return "rounded square mass";
+  }
+  return nullptr;
+}
+
+// a point of m at p within a hundredth, and with its key if both chose the same reference face
+static bool samePoint(const manifold& m, const manifold_point& p) {
+  float32 tol = float32(1) / float32(100);
+  for (int k = 0; k < m.point_count; k++) {
+    const manifold_point& q = m.points[k];
+    bool same_reference = (q.key >> 16 & 1) == (p.key >> 16 & 1);
+    if (abs(q.point.x - p.point.x) <= tol && abs(q.point.y - p.point.y) <= tol &&
+        abs(q.separation - p.separation) <= tol && (!same_reference || q.key == p.key)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// box pairs take their own manifold kernel, which picks the reference face by separation instead
+// of by the alignment with the normal. for boxes that overlap by less than an eighth both give
+// the same points, with normals a few degrees apart at most where the two faces nearly tie
+static const char* boxCheck(int) {
+  sequence random = {7};
+  shape_registry shapes;
+  int compared = 0;
+  for (int i = 0; i < CASES / 4; i++) {
+    vec2 origin(float32(0), float32(0));
+    body a = make_box(&shapes, origin, float32(1) + random.coordinate(32),
+                      float32(1) + random.coordinate(32), float32(1));
+    body b = make_box(&shapes, origin, float32(1) + random.coordinate(32),
+                      float32(1) + random.coordinate(32), float32(1));
+    a.r = random.coordinate(200);
+    b.center.x = random.coordinate(160);
+    b.center.y = random.coordinate(160);
+    b.r = random.coordinate(200);
+    const shape* sa = get_shape(&shapes, a.shape_id);
+    const shape* sb = get_shape(&shapes, b.shape_id);
+    shape general_a = *sa;
+    shape general_b = *sb;
+    general_a.box = false;
+    general_b.box = false;
+    float32 margin = float32(1) / float32(10);
+    manifold m, expected;
+    bool hit = polygon_manifold(&a, sa, &b, sb, margin, float32(0), &m);
+    bool expected_hit =
+        polygon_manifold(&a, &general_a, &b, &general_b, margin, float32(0), &expected);
+    bool shallow = true;
+    for (int k = 0; k < expected.point_count; k++) {
+      shallow = shallow && expected.points[k].separation > -float32(1) / float32(8);
+    }
+    if (!shallow) {
+      continue;
+    }
+    if (hit != expected_hit) {
+      return "box kernel and polygon path disagree on touching";
+    }
+    if (!hit) {
+      continue;
+    }
+    compared++;
+    if (m.point_count != expected.point_count ||
+        dot(m.normal, expected.normal) < float32(0.99f)) {
+      return "box kernel and polygon path give different manifolds";
+    }
+    for (int k = 0; k < m.point_count; k++) {
+      if (!samePoint(expected, m.points[k])) {
+        return "box kernel and polygon path give different points";
+      }
+    }
+  }
+  return compared > 0 ? nullptr : "no boxes touched";
+}
+
+// number of contact points of b with every edge of t, flat is cleared when one of them doesn't
+// push straight up
+static int edgeContacts(const chain_terrain* t, const shape_registry* shapes, const body* b,
+                        bool* flat) {
+  const shape* s = get_shape(shapes, b->shape_id);
+  int points = 0;
+  for (size_t i = 0; i < t->edges.size(); i++) {
+    manifold m;
+    if (!edge_manifold(&t->edges[i], b, s, float32(1) / float32(10), float32(0), &m)) {
+      continue;
+    }
+    if (!near(m.normal, vec2(float32(0), float32(1)))) {
+      *flat = false;
+    }
+    points += m.point_count;
+  }
+  return points;
+}
+
+// bodies sliding over the joint of two collinear chain edges get only face contacts pushing
+// straight up, the ghost vertices keep the joint's corner from snagging them, and a circle is only
+// ever touched by one of the edges, over a flat joint and over the top of a low hill alike. edges
+// far apart along a chain give their contacts different keys
+static const char* chainCheck(int) {
+  float32 half = float32(1) / float32(2);
+  float32 drop = float32(1) / float32(5);
+  vec2 ground[3] = {vec2(float32(-4), float32(0)), vec2(float32(0), float32(0)),
+                    vec2(float32(4), float32(0))};
+  vec2 hill[3] = {vec2(float32(-4), -drop), vec2(float32(0), float32(0)),
+                  vec2(float32(4), -drop)};
+  chain_terrain flat_terrain, hill_terrain;
+  add_chain(&flat_terrain, ground, 3, false);
+  build_terrain(&flat_terrain);
+  add_chain(&hill_terrain, hill, 3, false);
+  build_terrain(&hill_terrain);
+  shape_registry shapes;
+  for (int i = -16; i <= 16; i++) {
+    vec2 center(float32(i) / float32(16), half - float32(1) / float32(100));
+    body box = make_box(&shapes, center, half, half, float32(1));
+    box.vel.x = float32(1) / float32(4);
+    body circle = make_circle(&shapes, center, half, float32(1));
+    bool flat = true, unused = true;
+    int box_points = edgeContacts(&flat_terrain, &shapes, &box, &flat);
+    int circle_points = edgeContacts(&flat_terrain, &shapes, &circle, &flat);
+    if (!flat) {
+      return "a contact at the joint doesn't push straight up";
+    }
+    if (box_points == 0 || circle_points != 1 ||
+        edgeContacts(&hill_terrain, &shapes, &circle, &unused) != 1) {
+      return "wrong number of contacts at the joint";
+    }
+  }
+
+  // a wide box on a long flat chain touches more than 4096 of its edges, their contacts all share
+  // the pair with the terrain body and must not share keys
+  world w;
+  std::vector<vec2> points;
+  for (int i = 0; i <= 8192; i++) {
+    points.push_back(vec2(float32(i - 4096) / float32(1024), float32(0)));
+  }
+  add_chain(&w.terrain, &points[0], (int)points.size(), false);
+  finish_terrain(&w, float32(1));
+  add_body(&w, make_box(&w.shapes, vec2(float32(0), half - float32(1) / float32(100)),
+                        float32(3), half, float32(1)));
+  step_world(&w);
+  std::vector<uint32_t> keys;
+  for (size_t i = 0; i < w.contacts.size(); i++) {
+    for (int k = 0; k < w.contacts[i].point_count; k++) {
+      keys.push_back(w.contacts[i].points[k].key);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  if (keys.size() < 4096 || std::adjacent_find(keys.begin(), keys.end()) != keys.end()) {
+    return "contacts with the edges of a long chain share keys";
+  }
+  return nullptr;
+}
+
+static bool sameEdge(const chain_edge& a, const chain_edge& b) {
+  const vec2 av[5] = {a.v0, a.v1, a.ghost0, a.ghost1, a.normal};
+  const vec2 bv[5] = {b.v0, b.v1, b.ghost0, b.ghost1, b.normal};
+  for (int i = 0; i < 5; i++) {
+    if (av[i].x != bv[i].x || av[i].y != bv[i].y) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// heightfield cells are the edges of the chain through the samples, querying a box visits in
+// order exactly the cells whose bounds overlap it, and finish_terrain refuses fields without a
+// positive spacing and two samples. the origin is off the 1/64 grid of the boxes so none of
+// them ends right on a sample
+static const char* heightfieldCheck(int) {
+  sequence random = {8};
+  heightfield h;
+  h.origin = vec2(float32(-5) / float32(4) + float32(1) / float32(128), float32(1) / float32(2));
+  h.spacing = float32(3) / float32(8);
+  std::vector<int> visited;
+  h.heights.push_back(float32(0));
+  query_heightfield(&h, vec2(float32(-64), float32(-64)), vec2(float32(64), float32(64)),
+                    [&](int cell) { visited.push_back(cell); });
+  if (!visited.empty()) {
+    return "a heightfield with one sample has cells";
+  }
+  std::vector<vec2> points(1, h.origin);
+  for (int i = 1; i < 40; i++) {
+    h.heights.push_back(random.coordinate(64));
+    points.push_back(h.origin + vec2(float32(i) * h.spacing, h.heights[i]));
+  }
+  chain_terrain t;
+  add_chain(&t, &points[0], (int)points.size(), false);
+  for (int i = 0; i + 1 < (int)h.heights.size(); i++) {
+    if (!sameEdge(heightfield_edge(&h, i), t.edges[i])) {
+      return "a heightfield cell differs from the chain edge through its samples";
+    }
+  }
+
+  for (int i = 0; i < CASES; i++) {
+    vec2 lower(random.coordinate(1280), random.coordinate(192));
+    vec2 upper = lower + vec2(float32(int(random.next() % 512)) / float32(64),
+                              float32(int(random.next() % 192)) / float32(64));
+    visited.clear();
+    query_heightfield(&h, lower, upper, [&](int cell) { visited.push_back(cell); });
+    std::vector<int> expected;
+    for (int cell = 0; cell < (int)t.edges.size(); cell++) {
+      const chain_edge& e = t.edges[cell];
+      if (e.v0.x <= upper.x && lower.x <= e.v1.x && min(e.v0.y, e.v1.y) <= upper.y &&
+          lower.y <= max(e.v0.y, e.v1.y)) {
+        expected.push_back(cell);
+      }
+    }
+    if (visited != expected) {
+      return "a heightfield query visits the wrong cells";
+    }
+  }
+
+  // finish_terrain refuses fields it can't query
+  float32 nan;
+  nan.v.v = 0x7fc00000u;
+  const float32 spacings[4] = {float32(0), float32(-1), nan, float32(1)};
+  for (int k = 0; k < 5; k++) {
+    world w;
+    w.field.heights.assign(k == 4 ? 1 : 2, float32(0));
+    w.field.spacing = spacings[k % 4];
+    bool valid = k == 3;
+    if ((finish_terrain(&w, float32(1)) >= 0) != valid || (w.terrain_body >= 0) != valid) {
+      return "finish_terrain took a heightfield with a bad spacing or too few samples";
+    }
+  }
+  return nullptr;
+}
+
+// a compound of two boxes, the second one lower, resting on flat ground made of a static box or a
+// chain, both before and after the compound in the world. only the low box touches, so every
+// contact key has child 1 on the compound's side and 0 on the ground's
+static const char* compoundCheck(int) {
+  float32 half = float32(1) / float32(2);
+  for (int setup = 0; setup < 4; setup++) {
+    bool chain = setup & 1, compound_first = setup & 2;
+    world w;
+    int boxes[2] = {add_box(&w.shapes, half, half), add_box(&w.shapes, half, half)};
+    vec2 offsets[2] = {vec2(float32(-1), float32(1)), vec2(float32(1), float32(0))};
+    int id = -1;
+    vec2 centroid;
+    make_compound(&w.shapes, boxes, offsets, 2, &id, &centroid);
+    body b;
+    b.center = vec2(float32(0), half - float32(1) / float32(100)) + centroid;
+    b.shape_id = id;
+    set_body_mass(&b, get_shape(&w.shapes, id), float32(1));
+    vec2 ground[2] = {vec2(float32(-4), float32(0)), vec2(float32(4), float32(0))};
+    if (chain) {
+      add_chain(&w.terrain, ground, 2, false);
+    }
+    int index = compound_first ? add_body(&w, b) : -1;
+    if (chain) {
+      finish_terrain(&w, float32(1));
+    } else {
+      add_body(&w, make_box(&w.shapes, vec2(float32(0), -half), float32(4), half, float32(0)));
+    }
+    if (!compound_first) {
+      index = add_body(&w, b);
+    }
+    step_world(&w);
+    int points = 0;
+    for (size_t i = 0; i < w.contacts.size(); i++) {
+      const contact_constraint& c = w.contacts[i];
+      for (int k = 0; k < c.point_count; k++) {
+        uint32_t key = c.points[k].key;
+        int child = c.index_a == index ? key_child_a(key) : key_child_b(key);
+        int other = c.index_a == index ? key_child_b(key) : key_child_a(key);
+        if (child != 1 || other != 0) {
+          return "a contact key names the wrong child";
+        }
+        points++;
+      }
+    }
+    if (points == 0) {
+      return "the compound doesn't touch the ground";
+    }
+  }
+  return nullptr;
+}
+
+// a small circle thrown through a thin wall in one step without gravity. a pair uses the most
+// thorough mode of its dynamic bodies, so the circle only passes the wall when neither of them
+// looks further than the contact margin. a static wall's own mode doesn't count
+static const char* ccdModeCheck(int) {
+  struct setup {
+    ccd_mode bullet, wall;
+    bool dynamic_wall, passes;
+  };
+  const setup setups[] = {
+      {CCD_OFF, CCD_FULL, false, true},        {CCD_SPECULATIVE, CCD_OFF, false, false},
+      {CCD_FULL, CCD_OFF, false, false},       {CCD_OFF, CCD_FULL, true, false},
+      {CCD_OFF, CCD_SPECULATIVE, true, false}, {CCD_OFF, CCD_OFF, true, true},
+  };
+  for (int i = 0; i < (int)(sizeof(setups) / sizeof(setups[0])); i++) {
+    const setup& s = setups[i];
+    world w;
+    body wall = make_box(&w.shapes, vec2(float32(0), float32(0)), float32(1) / float32(20),
+                         float32(2), s.dynamic_wall ? float32(1) : float32(0));
+    wall.ccd = s.wall;
+    body bullet = make_circle(&w.shapes, vec2(-float32(3) / float32(2), float32(0)),
+                              float32(1) / float32(10), float32(1));
+    bullet.vel.x = float32(1);
+    bullet.ccd = s.bullet;
+    int a = add_body(&w, wall);
+    int b = add_body(&w, bullet);
+    for (int frame = 0; frame < 4; frame++) {
+      step_world(&w);
+    }
+    if ((w.bodies[b].center.x > w.bodies[a].center.x) != s.passes) {
+      return s.passes ? "a pair without ccd doesn't pass the wall" : "a ccd pair tunnels";
+    }
+  }
+  return nullptr;
+}
+
+// the world filter callback of the filter check, rejects every pair with the body in user
+static bool rejectBody(const world*, int index_a, int index_b, void* user) {
+  int index = *(const int*)user;
+  return index_a != index && index_b != index;
+}
+
+// two overlapping boxes resting on a chain, with filters on the first box. a shared negative group
+// or masks that don't take each other's category keep them apart, a shared positive group pairs
+// them whatever the masks, and the world callback drops the pairs it rejects. the terrain body has
+// the default filter
+static const char* filterCheck(int) {
+  struct setup {
+    uint32_t category_a, mask_a, category_b, mask_b;
+    int group_a, group_b;
+    bool callback, pair, terrain;
+  };
+  const uint32_t all = 0xffffffff;
+  const setup setups[] = {
+      {1, all, 1, all, 0, 0, false, true, true},   {1, 2, 1, all, 0, 0, false, false, false},
+      {1, all, 2, ~2u, 0, 0, false, true, true},   {2, all, 1, ~2u, 0, 0, false, false, true},
+      {1, all, 1, all, -1, -1, false, false, true}, {1, all, 1, all, -1, -2, false, true, true},
+      {1, 0, 1, 0, 3, 3, false, true, false},      {1, all, 1, all, 0, 0, true, false, false},
+  };
+  float32 half = float32(1) / float32(2);
+  vec2 ground[2] = {vec2(float32(-4), float32(0)), vec2(float32(4), float32(0))};
+  for (int i = 0; i < (int)(sizeof(setups) / sizeof(setups[0])); i++) {
+    const setup& s = setups[i];
+    world w;
+    body a = make_box(&w.shapes, vec2(float32(0), half), half, half, float32(1));
+    body b = make_box(&w.shapes, vec2(half, half), half, half, float32(1));
+    a.filter.category = s.category_a;
+    a.filter.mask = s.mask_a;
+    a.filter.group = s.group_a;
+    b.filter.category = s.category_b;
+    b.filter.mask = s.mask_b;
+    b.filter.group = s.group_b;
+    int index = add_body(&w, a);
+    add_body(&w, b);
+    add_chain(&w.terrain, ground, 2, false);
+    finish_terrain(&w, float32(1));
+    if (s.callback) {
+      w.filter = rejectBody;
+      w.filter_user = &index;
+    }
+    step_world(&w);
+    bool terrain = false;
+    for (size_t k = 0; k < w.terrain_pairs.size(); k++) {
+      terrain = terrain || w.terrain_pairs[k].index == index;
+    }
+    if (!w.pairs.empty() != s.pair || terrain != s.terrain) {
+      return "a filter lets the wrong pairs through";
+    }
+  }
+  return nullptr;
+}
+
+// draws are sequenced one per statement, the order of evaluation of arguments is unspecified
+static body randomBody(sequence* random, shape_registry* shapes) {
+  vec2 center;
+  center.x = random->coordinate(320);
+  center.y = random->coordinate(320);
+  int sides = 3 + random->next() % (MAX_VERTICES - 2);
+  body b = make_polygon(shapes, center, sides, float32(1), float32(1));
+  b.r = random->coordinate(200);
+  b.vel.x = random->coordinate(320);
+  b.vel.y = random->coordinate(320);
+  b.w = random->coordinate(32);
+  return b;
+}
+
+static void ccdLines(std::vector<golden_line>* lines) {
+  hasher hits, times, impacts, polynomial;
+  sequence random = {4};
+  shape_registry shapes;
+  for (int i = 0; i < CASES / 4; i++) {
+    body a = randomBody(&random, &shapes);
+    body b = randomBody(&random, &shapes);
+    const shape* sa = get_shape(&shapes, a.shape_id);
+    const shape* sb = get_shape(&shapes, b.shape_id);
+    float32 t;
+    feature fa, fb;
+    vec2 impact;
+    bool hit = continuous_collision(&a, sa, &b, sb, &t, &fa, &fb, &impact, float32(0),
+                                    ROTATION_EXACT);
+    hits.add((uint32_t)hit);
+    if (hit) {
+      times.add(t);
+      impacts.add(impact);
+      impacts.add(fa);
+      impacts.add(fb);
+    }
+    hit = continuous_collision(&a, sa, &b, sb, &t, &fa, &fb, &impact, float32(0),
+                               ROTATION_POLYNOMIAL);
+    polynomial.add((uint32_t)hit);
+    if (hit) {
+      polynomial.add(t);
+      polynomial.add(impact);
+    }
+  }
+  lines->push_back({"hits", hits.h});
+  lines->push_back({"times", times.h});
+  lines->push_back({"impacts", impacts.h});
+  lines->push_back({"polynomial", polynomial.h});
+}
+
+// distance between the polygons of two bodies at time t
+static float32 distanceAt(const body* a, const shape* sa, const body* b, const shape* sb,
+                          float32 t) {
+  vec2 pa[MAX_VERTICES], pb[MAX_VERTICES];
+  get_absolute_vertices(a, sa, pa, t);
+  get_absolute_vertices(b, sb, pb, t);
+  return polygon_distance(pa, sa->num_vertices, pb, sb->num_vertices, NULL, NULL, NULL, NULL);
+}
+
+// pairs that don't rotate are solved in closed form. sampling the step finds no contact before
+// the time of impact, the polygons are within the tolerance there, and pairs that miss never touch
+static const char* translatingCheck(int) {
+  sequence random = {6};
+  shape_registry shapes;
+  const int samples = 256;
+  int hits = 0;
+  for (int i = 0; i < CASES / 16; i++) {
+    body a = randomBody(&random, &shapes);
+    body b = randomBody(&random, &shapes);
+    a.w = float32(0);
+    b.w = float32(0);
+    const shape* sa = get_shape(&shapes, a.shape_id);
+    const shape* sb = get_shape(&shapes, b.shape_id);
+    float32 t = float32(1);
+    feature fa, fb;
+    vec2 impact;
+    bool hit = continuous_collision(&a, sa, &b, sb, &t, &fa, &fb, &impact, float32(0),
+                                    ROTATION_EXACT);
+    if (hit && distanceAt(&a, sa, &b, sb, t) > float32(1) / float32(100)) {
+      return "polygons apart at the time of impact";
+    }
+    // pairs that touch at the start hit at once
+    for (int k = 0; t > float32(0) && k < samples; k++) {
+      float32 sample = t * float32(k) / float32(samples);
+      if (distanceAt(&a, sa, &b, sb, sample) == float32(0)) {
+        return hit ? "contact before the time of impact" : "contact the sweep missed";
+      }
+    }
+    hits += hit;
+  }
+  return hits > 0 ? nullptr : "no pair hit";
+}
+
+static void sceneLines(const scene* s, int frames, std::vector<golden_line>* lines) {
+  world w;
+  s->build(&w);
+  state_hash h;
+  hasher events;
+  int event_count = 0;
+  char key[16];
+  for (int i = 0; i < frames; i++) {
+    step_world(&w);
+    update_state_hash(&h, &w);
+    snprintf(key, sizeof(key), "%d", i + 1);
+    lines->push_back({key, h.value});
+    for (size_t j = 0; j < w.overlap_events.size(); j++) {
+      events.add((uint32_t)w.overlap_events[j].sensor);
+      events.add((uint32_t)w.overlap_events[j].other);
+      events.add((uint32_t)w.overlap_events[j].type);
+      event_count++;
+    }
+  }
+  // scenes with sensors also check the overlap events
+  if (event_count > 0) {
+    lines->push_back({"overlap_events", events.h});
+  }
+}
+
+static uint64_t worldHash(const world* w) {
+  state_hash h;
+  update_state_hash(&h, w);
+  return h.value;
+}
+
+// frame by frame state hashes of a scene
+static void sceneHashes(world* w, int frames, std::vector<uint64_t>* hashes) {
+  for (int i = 0; i < frames; i++) {
+    step_world(w);
+    hashes->push_back(worldHash(w));
+  }
+}
+
+// the solver splits colors between threads, every thread count gives the same state
+static const char* threadCheck(int frames) {
+  const char* names[] = {"pyramid", "compounds"};
+  thread_pool pool(4);
+  for (int k = 0; k < 2; k++) {
+    const scene* s = find_scene(names[k]);
+    world single;
+    s->build(&single);
+    std::vector<uint64_t> expected;
+    sceneHashes(&single, frames, &expected);
+
+    world threaded;
+    s->build(&threaded);
+    threaded.pool = &pool;
+    std::vector<uint64_t> hashes;
+    sceneHashes(&threaded, frames, &hashes);
+    if (hashes != expected) {
+      return "4 threads differ from 1";
+    }
+  }
+  return nullptr;
+}
+
+// stepping on from a restored snapshot repeats the frames after it, in the same world and in a
+// freshly built one
+static const char* snapshotCheck(int frames) {
+  const scene* s = find_scene("compounds");
+  world w;
+  s->build(&w);
+  for (int i = 0; i < frames / 2; i++) {
+    step_world(&w);
+  }
+  std::vector<uint8_t> saved(snapshot_size(&w));
+  if (save_snapshot(&w, saved.data(), saved.size()) != saved.size()) {
+    return "save_snapshot wrote the wrong size";
+  }
+  std::vector<uint64_t> expected;
+  sceneHashes(&w, frames / 2, &expected);
+
+  if (!restore_snapshot(&w, saved.data(), saved.size())) {
+    return "restore_snapshot rejected its own snapshot";
+  }
+  std::vector<uint64_t> hashes;
+  sceneHashes(&w, frames / 2, &hashes);
+  if (hashes != expected) {
+    return "frames after a restore differ";
+  }
+
+  world fresh;
+  s->build(&fresh);
+  if (!restore_snapshot(&fresh, saved.data(), saved.size())) {
+    return "restore_snapshot rejected a snapshot of the same scene";
+  }
+  hashes.clear();
+  sceneHashes(&fresh, frames / 2, &hashes);
+  if (hashes != expected) {
+    return "frames after a restore into a new world differ";
+  }
+  return nullptr;
+}
+
+static bool samePairs(const std::vector<body_pair>& a, const std::vector<body_pair>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].index_a != b[i].index_a || a[i].index_b != b[i].index_b) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// steps w and appends its overlap events, false if one begins for a pair that already overlapped
+static bool overlapEvents(world* w, int frames, std::vector<int>* events) {
+  std::vector<body_pair> before;
+  for (int f = 0; f < frames; f++) {
+    before = w->overlaps;
+    step_world(w);
+    for (size_t i = 0; i < w->overlap_events.size(); i++) {
+      const overlap_event& e = w->overlap_events[i];
+      body_pair p = {std::min(e.sensor, e.other), std::max(e.sensor, e.other)};
+      for (size_t j = 0; j < before.size() && e.type == OVERLAP_BEGIN; j++) {
+        if (before[j].index_a == p.index_a && before[j].index_b == p.index_b) {
+          return false;
+        }
+      }
+      events->push_back(f);
+      events->push_back(e.sensor);
+      events->push_back(e.other);
+      events->push_back(e.type);
+    }
+  }
+  return true;
+}
+
+// a snapshot saved while sensors overlap restores their overlaps, so stepping on repeats the
+// recorded events without beginning the overlaps again
+static const char* overlapCheck(int frames) {
+  const scene* s = find_scene("sensors");
+  world w;
+  s->build(&w);
+  for (int i = 0; i < frames && w.overlaps.empty(); i++) {
+    step_world(&w);
+  }
+  if (w.overlaps.empty()) {
+    return "no sensor overlaps to save";
+  }
+  std::vector<uint8_t> saved(snapshot_size(&w));
+  save_snapshot(&w, saved.data(), saved.size());
+  std::vector<int> expected;
+  if (!overlapEvents(&w, frames / 2, &expected)) {
+    return "an overlap began twice";
+  }
+
+  if (!restore_snapshot(&w, saved.data(), saved.size())) {
+    return "restore_snapshot rejected its own snapshot";
+  }
+  std::vector<int> events;
+  if (!overlapEvents(&w, frames / 2, &events) || events != expected) {
+    return "overlap events after a restore differ";
+  }
+
+  world fresh;
+  s->build(&fresh);
+  if (!restore_snapshot(&fresh, saved.data(), saved.size())) {
+    return "restore_snapshot rejected a snapshot of the same scene";
+  }
+  events.clear();
+  if (!overlapEvents(&fresh, frames / 2, &events) || events != expected) {
+    return "overlap events after a restore into a new world differ";
+  }
+  return nullptr;
+}
+
+static body_input testInput(const world* w, int frame) {
+  body_input input;
+  input.frame = frame;
+  input.body = 3 + (frame * 7) % ((int)w->bodies.size() - 3);
+  input.impulse = vec2(float32(1) / float32(10), float32(3) / float32(10));
+  input.angular_impulse = float32(1) / float32(20);
+  return input;
+}
+
+// the hash that only rehashes the change log of the world matches a full rehash on every frame,
+// through inputs, the log dropping old entries and a snapshot restore. one updated every frame
+// never rehashes the static bodies after its first update except for the restore, one updated
+// every few frames can fall behind the log and rehash everything, and none is carried over to
+// another world
+static const char* hashCheck(int frames) {
+  world w;
+  find_scene("sensors")->build(&w);
+  std::vector<uint8_t> saved(snapshot_size(&w));
+  save_snapshot(&w, saved.data(), saved.size());
+  state_hash h, behind;
+  for (int f = 0; f < frames; f++) {
+    if (f == frames / 2 && !restore_snapshot(&w, saved.data(), saved.size())) {
+      return "restore_snapshot rejected its own snapshot";
+    }
+    apply_input(&w, testInput(&w, f));
+    step_world(&w);
+    bool partial = update_state_hash(&h, &w) < (int)w.bodies.size();
+    if (f > 0 && f != frames / 2 && !partial) {
+      return "an update every frame rehashed every body";
+    }
+    if (h.value != worldHash(&w)) {
+      return "incremental hash differs from a full rehash";
+    }
+    if (f % 4 == 3) {
+      update_state_hash(&behind, &w);
+      if (behind.value != h.value) {
+        return "a hash updated every few frames differs";
+      }
+    }
+  }
+
+  // a world built again at the same address with a static body moved, stepped until its log
+  // reaches where the hash was. the log never names the static body
+  world other;
+  find_scene("sensors")->build(&other);
+  step_world(&other);
+  update_state_hash(&h, &other);
+  size_t seen = h.seen;
+  other.~world();
+  new (&other) world();
+  find_scene("sensors")->build(&other);
+  for (size_t i = 0; i < other.bodies.size(); i++) {
+    if (!is_dynamic(&other.bodies[i])) {
+      other.bodies[i].center.x += float32(1);
+      break;
+    }
+  }
+  for (int f = 0; other.changed_base + other.changed_bodies.size() < seen; f++) {
+    apply_input(&other, testInput(&other, f));
+    step_world(&other);
+  }
+  update_state_hash(&h, &other);
+  return h.value == worldHash(&other) ? nullptr : "a hash followed a world rebuilt in its place";
+}
+
+// inputs arriving a few frames late are rolled back into their frame, once the resimulation is
+// done the world matches one that had them on time
+static const char* rollbackCheck(int frames) {
+  const int delay = 5;
+  const char* names[] = {"polygon_pile", "sensors"};
+  for (int k = 0; k < 2; k++) {
+    const scene* s = find_scene(names[k]);
+    world on_time;
+    s->build(&on_time);
+    world w;
+    s->build(&w);
+    rollback late;
+    init_rollback(&late, &w, 8);
+    for (int f = 0; f < frames; f++) {
+      if (f % 10 == 3) {
+        apply_input(&on_time, testInput(&on_time, f));
+      }
+      step_world(&on_time);
+
+      if (f >= delay && (f - delay) % 10 == 3 && !add_input(&late, testInput(&w, f - delay))) {
+        return "add_input refused a late input within the history";
+      }
+      advance_frame(&late);
+      // frames the latest input was still on its way
+      bool in_flight = f % 10 >= 3 && f % 10 < 3 + delay;
+      if (!in_flight && worldHash(&w) != worldHash(&on_time)) {
+        return "resimulated frames differ from on time inputs";
+      }
+      if (!in_flight && !samePairs(w.overlaps, on_time.overlaps)) {
+        return "resimulated sensor overlaps differ from on time inputs";
+      }
+    }
+    if (late.stats[delay].rollbacks == 0) {
+      return "no rollback happened";
+    }
+  }
+  return nullptr;
+}
+
+// false unless target decodes bit for bit from its delta against baseline, and the delta cut short
+// by a byte is rejected
+static bool deltaRoundTrip(const std::vector<uint8_t>& baseline,
+                           const std::vector<uint8_t>& target) {
+  std::vector<uint8_t> delta(max_delta_size(target.data()));
+  size_t size = encode_delta(baseline.data(), target.data(), delta.data(), delta.size());
+  if (size == 0) {
+    return false;
+  }
+  std::vector<uint8_t> decoded(target.size());
+  if (decode_delta(baseline.data(), delta.data(), size, decoded.data(), decoded.size()) !=
+          target.size() ||
+      memcmp(decoded.data(), target.data(), target.size()) != 0) {
+    return false;
+  }
+  return decode_delta(baseline.data(), delta.data(), size - 1, decoded.data(), decoded.size()) ==
+         0;
+}
+
+// deltas against the previous frame and against the first one decode to the exact snapshot
+static const char* deltaCheck(int frames) {
+  const char* names[] = {"terrain", "sensors"};
+  for (int k = 0; k < 2; k++) {
+    world w;
+    find_scene(names[k])->build(&w);
+    std::vector<uint8_t> first, previous, current;
+    for (int f = 0; f <= frames; f++) {
+      current.resize(snapshot_size(&w));
+      save_snapshot(&w, current.data(), current.size());
+      if (f > 0 && (!deltaRoundTrip(previous, current) || !deltaRoundTrip(first, current))) {
+        return "decoded snapshot differs from the encoded one";
+      }
+      if (f == 0) {
+        first = current;
+      }
+      previous.swap(current);
+      step_world(&w);
+    }
+  }
+  return nullptr;
+}
+
+static void digCrater(world* w) {
+  for (int i = 400; i < 420; i++) {
+    w->field.heights[i] -= float32(1) / float32(2);
+  }
+  mark_heights_changed(w);
+}
+
+// an edit of the heightfield changes the state hash, is undone by restoring a snapshot from
+// before it and stays in the history a rollback resimulates through
+static const char* heightsCheck(int frames) {
+  const scene* s = find_scene("heightfield");
+  world w;
+  s->build(&w);
+  state_hash h;
+  update_state_hash(&h, &w);
+  state_hash before = h;
+  std::vector<uint8_t> saved(snapshot_size(&w));
+  save_snapshot(&w, saved.data(), saved.size());
+  digCrater(&w);
+  update_state_hash(&h, &w);
+  state_divergence d;
+  if (h.value == before.value || h.value != worldHash(&w) || !diff_state(&before, &h, &d) ||
+      d.field != STATE_HEIGHTS) {
+    return "the state hash missed an edit of the heights";
+  }
+  std::vector<uint8_t> dug(snapshot_size(&w));
+  save_snapshot(&w, dug.data(), dug.size());
+  if (!deltaRoundTrip(saved, dug)) {
+    return "decoded snapshot differs from the encoded one";
+  }
+  restore_snapshot(&w, saved.data(), saved.size());
+  update_state_hash(&h, &w);
+  if (h.value != before.value) {
+    return "restoring a snapshot didn't undo an edit of the heights";
+  }
+
+  // the input of frame 83 arrives at frame 88, after the crater was dug at frame 85 under the
+  // body it pushes, so the rollback wakes bodies standing on the edited cells
+  world on_time;
+  s->build(&on_time);
+  world late_world;
+  s->build(&late_world);
+  body_input input = testInput(&on_time, 83);
+  input.body = 7;
+  rollback late;
+  init_rollback(&late, &late_world, 8);
+  for (int f = 0; f < frames; f++) {
+    if (f == 85) {
+      digCrater(&on_time);
+      digCrater(&late_world);
+    }
+    if (f == 83) {
+      apply_input(&on_time, input);
+    }
+    step_world(&on_time);
+    if (f == 88 && !add_input(&late, input)) {
+      return "add_input refused a late input within the history";
+    }
+    advance_frame(&late);
+    if ((f < 83 || f >= 88) && worldHash(&late_world) != worldHash(&on_time)) {
+      return "resimulated frames differ from on time inputs";
+    }
+  }
+  return nullptr;
+}
+
+// a recording seeks to any frame with the recorded state and plays on without a hash mismatch,
+// while a world that doesn't match the recording is caught
+static const char* replayRun(const char* path, int frames) {
+  const scene* s = find_scene("polygon_pile");
+  world w;
+  s->build(&w);
+  replay_recorder rec;
+  if (!open_recording(&rec, path, &w, 16)) {
+    return "can't create the recording";
+  }
+  std::vector<uint64_t> recorded;
+  for (int f = 0; f < frames; f++) {
+    recorded.push_back(worldHash(&w));
+    body_input input = testInput(&w, f);
+    int count = f % 10 == 3;
+    record_frame(&rec, &w, &input, count);
+    if (count) {
+      apply_input(&w, input);
+    }
+    step_world(&w);
+  }
+  close_recording(&rec);
+
+  world played;
+  s->build(&played);
+  replay_player p;
+  if (!open_replay(&p, path, &played) || replay_frame_count(&p) != frames) {
+    return "can't open the recording";
+  }
+  const int seeks[] = {frames / 2, frames - 1, 3, 0};
+  for (int i = 0; i < 4; i++) {
+    if (!seek_replay(&p, seeks[i]) || worldHash(&played) != recorded[seeks[i]]) {
+      close_replay(&p);
+      return "seeking reached a different state than recorded";
+    }
+  }
+  while (step_replay(&p)) {
+  }
+  int mismatch = p.first_mismatch;
+  close_replay(&p);
+  if (mismatch >= 0) {
+    return "playing from the start mismatched the recorded hashes";
+  }
+
+  world changed;
+  s->build(&changed);
+  changed.bodies[10].friction = float32(0);
+  if (!open_replay(&p, path, &changed)) {
+    return "can't open the recording";
+  }
+  while (step_replay(&p)) {
+  }
+  mismatch = p.first_mismatch;
+  close_replay(&p);
+  return mismatch < 0 ? "a different world played without a mismatch" : nullptr;
+}
+
+static const char* replayCheck(int frames) {
+  const char* path = "jumphysics_test.replay";
+  const char* failure = replayRun(path, frames);
+  remove(path);
+  return failure;
+}
+
+// a batch stepped on a pool leaves every world in the state the same batch reaches on one thread
+static const char* batchCheck(int frames) {
+  const char* names[] = {"fans", "rounded", "bullets", "terrain", "locked_bullets"};
+  const int count = 5;
+  world serial_worlds[count];
+  world pooled_worlds[count];
+  world_batch serial;
+  world_batch pooled;
+  thread_pool pool(4);
+  pooled.pool = &pool;
+  pooled.group_size = 1;
+  for (int i = 0; i < count; i++) {
+    find_scene(names[i])->build(&serial_worlds[i]);
+    find_scene(names[i])->build(&pooled_worlds[i]);
+    add_world(&serial, &serial_worlds[i]);
+    add_world(&pooled, &pooled_worlds[i]);
+  }
+  for (int f = 0; f < frames / 2; f++) {
+    step_batch(&serial);
+    step_batch(&pooled);
+    for (int i = 0; i < count; i++) {
+      if (worldHash(&serial_worlds[i]) != worldHash(&pooled_worlds[i])) {
+        return "a world stepped on 4 threads differs from 1";
+      }
+    }
+  }
+  return nullptr;
+}
+
+// a self-checking group returns null or what went wrong
+typedef const char* (*self_check)(int frames);
+
+static bool selfCheck(const char* name, self_check fn, int frames) {
+  const char* failure = fn(frames);
+  if (failure) {
+    printf("%-16s FAIL: %s\n", name, failure);
+    return false;
+  }
+  printf("%-16s ok\n", name);
+  return true;
+}
+
+static bool readGolden(const std::string& path, std::vector<golden_line>* lines) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) {
+    return false;
+  }
+  char key[64];
+  unsigned long long hash;
+  while (fscanf(file, "%63s %llx", key, &hash) == 2) {
+    lines->push_back({key, (uint64_t)hash});
+  }
+  fclose(file);
+  return true;
+}
+
+static bool writeGolden(const std::string& path, const std::vector<golden_line>& lines) {
+  FILE* file = fopen(path.c_str(), "w");
+  if (!file) {
+    return false;
+  }
+  for (size_t i = 0; i < lines.size(); i++) {
+    fprintf(file, "%s %016llx\n", lines[i].key.c_str(), (unsigned long long)lines[i].hash);
+  }
+  fclose(file);
+  return true;
+}
+
+// groups are only run when they have a golden file to compare with, or to record one. skipped
+// counts the ones that have neither
+static bool hasGolden(const char* dir, const char* name, bool update, int* skipped) {
+  if (update) {
+    return true;
+  }
+  std::string path = std::string(dir) + "/" + name + ".txt";
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) {
+    printf("%-16s NOT RUN, no golden file %s\n", name, path.c_str());
+    (*skipped)++;
+    return false;
+  }
+  fclose(file);
+  return true;
+}
+
+// returns false on the first line that differs from the golden file
+static bool check(const char* dir, const char* name, const std::vector<golden_line>& lines,
+                  bool update) {
+  std::string path = std::string(dir) + "/" + name + ".txt";
+  if (update) {
+    bool ok = writeGolden(path, lines);
+    printf("%-16s %s\n", name, ok ? "updated" : "could not write golden file");
+    return ok;
+  }
+
+  std::vector<golden_line> golden;
+  if (!readGolden(path, &golden)) {
+    printf("%-16s could not read %s\n", name, path.c_str());
+    return false;
+  }
+  for (size_t i = 0; i < lines.size(); i++) {
+    if (i >= golden.size()) {
+      printf("%-16s golden file ends before %s\n", name, lines[i].key.c_str());
+      return false;
+    }
+    if (golden[i].key != lines[i].key || golden[i].hash != lines[i].hash) {
+      printf("%-16s FAIL at %s: %016llx, golden %s %016llx\n", name, lines[i].key.c_str(),
+             (unsigned long long)lines[i].hash, golden[i].key.c_str(),
+             (unsigned long long)golden[i].hash);
+      return false;
+    }
+  }
+  printf("%-16s ok (%d hashes)\n", name, (int)lines.size());
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* dir = JUMPHYSICS_GOLDEN_DIR;
+  int frames = 120;
+  bool update = false;
+  bool goldens = true;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+      dir = argv[++i];
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--update") == 0) {
+      update = true;
+    } else if (strcmp(argv[i], "--checks") == 0) {
+      goldens = false;
+    } else {
+      fprintf(stderr, "usage: %s [--golden dir] [--frames n] [--update] [--checks]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  typedef void (*group_lines)(std::vector<golden_line>* lines);
+  const char* group_names[] = {"float32", "trig", "gjk", "ccd", "shapes"};
+  const group_lines groups[] = {float32Lines, trigLines, gjkLines, ccdLines, shapeLines};
+
+  int failures = 0;
+  int skipped = 0;
+  std::vector<golden_line> lines;
+  for (int i = 0; goldens && i < (int)(sizeof(groups) / sizeof(groups[0])); i++) {
+    if (hasGolden(dir, group_names[i], update, &skipped)) {
+      lines.clear();
+      groups[i](&lines);
+      failures += !check(dir, group_names[i], lines, update);
+    }
+  }
+  for (int i = 0; goldens && i < scene_count; i++) {
+    std::string name = std::string("scene_") + scenes[i].name;
+    if (hasGolden(dir, name.c_str(), update, &skipped)) {
+      lines.clear();
+      sceneLines(scenes + i, frames, &lines);
+      failures += !check(dir, name.c_str(), lines, update);
+    }
+  }
+
+  const char* check_names[] = {"rounded", "translating", "boxes", "chain", "heightfield",
+                               "compound", "ccd_modes", "filters", "threads", "snapshot",
+                               "overlaps", "hash", "rollback", "delta", "heights", "replay",
+                               "batch"};
+  const self_check checks[] = {roundedCheck, translatingCheck, boxCheck, chainCheck,
+                               heightfieldCheck, compoundCheck, ccdModeCheck, filterCheck,
+                               threadCheck, snapshotCheck, overlapCheck, hashCheck, rollbackCheck,
+                               deltaCheck, heightsCheck, replayCheck, batchCheck};
+  for (int i = 0; i < (int)(sizeof(checks) / sizeof(checks[0])); i++) {
+    failures += !selfCheck(check_names[i], checks[i], frames);
+  }
+  if (failures) {
+    return 1;
+  }
+  if (skipped) {
+    printf("%d golden groups not run, record them with --update on a reference trig build\n",
+           skipped);
+    return SKIPPED;
+  }
+  return 0;
+}